@@ -0,0 +1,15 @@
+// Extensions have to come before any declaration, this file is pasted first
+#ifdef CAMERA_UBO
+#extension GL_ARB_uniform_buffer_object : require
+#endif
+
+// Fractal parameters shared by the distance estimators and the marcher
+uniform float power;
+uniform int iterations;
+uniform float epsilon;
+uniform float maxDistance;
+uniform float boundingExtent;       // Bounding sphere radius or box half-size of the estimator, see fractalBounds()
+
+// Mandelbox
+uniform float boxScale;
+uniform float boxFoldLimit;
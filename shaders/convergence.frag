@@ -0,0 +1,35 @@
+uniform sampler2D history;
+uniform sampler2D snapshot;          // history at the previous check
+uniform vec2 resolution;
+uniform vec2 gridSize;
+uniform float tileSize;
+
+float luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// One texel per adaptive tile: squared change of the luminance since the snapshot, total luminance and pixel count
+void main()
+{
+    // Tiles are numbered from the top like the adaptive tiles, texture rows from the bottom
+    vec2 tile = vec2(floor(gl_FragCoord.x), floor(gridSize.y - gl_FragCoord.y));
+    vec2 origin = tile * tileSize;
+
+    vec3 sums = vec3(0.0);
+    for (int y = 0; y < 64; ++y)
+    {
+        if (float(y) >= tileSize || origin.y + float(y) >= resolution.y) break;
+        for (int x = 0; x < 64; ++x)
+        {
+            if (float(x) >= tileSize || origin.x + float(x) >= resolution.x) break;
+
+            vec2 uv = vec2(origin.x + float(x) + 0.5, resolution.y - origin.y - float(y) - 0.5) / resolution;
+            float current = luminance(texture2D(history, uv).rgb);
+            float difference = current - luminance(texture2D(snapshot, uv).rgb);
+            sums += vec3(difference * difference, current, 1.0);
+        }
+    }
+
+    gl_FragColor = vec4(sums, 1.0);
+}
@@ -1,30 +1,172 @@
-float mandelbulDE(in vec3 p, out vec3 trap)
+#include "common.glsl"
+
+// Exactly one estimator is compiled, chosen by the FRACTAL_* define of the shader variant
+
+// a * b^T, outerProduct() needs GLSL 1.20
+mat3 outer(vec3 a, vec3 b)
 {
+    return mat3(a * b.x, a * b.y, a * b.z);
+}
+
+#if defined(FRACTAL_MANDELBOX)
+
+float mandelboxDE(vec3 p, out vec3 trap)
+{
+    const float minRadius2 = 0.5;
+    const float fixedRadius2 = 1.;
     vec3 z = p;
     float dr = 1.0;
-    float r = 0.;
     trap = vec3(1e20);
 
-    for (int i = 0; i < 10; i++)
+    for (int i = 0; i < 20; i++)
     {
-        trap = min(trap, dot(z, z));
+        z = clamp(z, -boxFoldLimit, boxFoldLimit) * 2.0 - z; //Box fold
 
-        r = length(z);
-        if (r > 4.)
-        break;
+        // Sphere fold
+        float r2 = dot(z, z);
+        if (r2 < minRadius2) {
+            float temp = fixedRadius2 / minRadius2;
+            z *= temp;
+            dr *= temp;
+        }
+        else if (r2 < fixedRadius2) {
+            float temp = fixedRadius2 / r2;
+            z *= temp;
+            dr *= temp;
+        }
 
-        float theta = acos(z.z / r) * power;
-        float phi = atan(z.y, z.x) * power;
+        z = boxScale * z + p;
+        dr = dr * abs(boxScale) + 1.;
+        trap = min(trap, abs(z));
 
-        dr = pow(r, power - 1.) * power * dr + 1.;
-        z = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)) * pow(r, power) + p;
+        if (dot(z, z) > 10000.) break;
     }
-    return 0.5 * log(r) * r / dr;
+    return length(z) / abs(dr);
+}
+
+// Gradient of mandelboxDE, the Jacobian of z and the gradient of dr carried through the same iteration
+vec3 mandelboxGradient(vec3 p)
+{
+    const float minRadius2 = 0.5;
+    const float fixedRadius2 = 1.;
+    vec3 z = p;
+    mat3 J = mat3(1.0);
+    float dr = 1.0;
+    vec3 drGradient = vec3(0.0);
+
+    for (int i = 0; i < 20; i++)
+    {
+        // Components outside the fold limit are mirrored
+        vec3 mirror = 1.0 - 2.0 * step(boxFoldLimit, abs(z));
+        J[0] *= mirror;
+        J[1] *= mirror;
+        J[2] *= mirror;
+        z = clamp(z, -boxFoldLimit, boxFoldLimit) * 2.0 - z;
+
+        float r2 = dot(z, z);
+        if (r2 < minRadius2) {
+            float temp = fixedRadius2 / minRadius2;
+            z *= temp;
+            J *= temp;
+            dr *= temp;
+            drGradient *= temp;
+        }
+        else if (r2 < fixedRadius2) {
+            // Inversion in the sphere, temp depends on z as well
+            float temp = fixedRadius2 / r2;
+            drGradient = drGradient * temp - (z * J) * (2.0 * temp * dr / r2);
+            J = (mat3(temp) - outer(z, z) * (2.0 * temp / r2)) * J;
+            z *= temp;
+            dr *= temp;
+        }
+
+        z = boxScale * z + p;
+        J = boxScale * J + mat3(1.0);
+        dr = dr * abs(boxScale) + 1.;
+        drGradient *= abs(boxScale);
+
+        if (dot(z, z) > 10000.) break;
+    }
+
+    float r = length(z);
+    return normalize((z * J) / (r * abs(dr)) - drGradient * (r * sign(dr) / (dr * dr)));
 }
 
-float kleinianDE(vec3 p, inout float currentIter){
+// Deep zoom: the orbit of referencePoint, iterated in double precision by ReferenceOrbit and rounded per iteration
+uniform vec3 referenceOrbit[21];
+uniform int referenceLength;        // Iterations before the reference escapes, 0 runs the plain estimator
+
+// Sphere fold of mandelboxDE as a scale at squared radius r2
+float sphereFoldScale(float r2)
+{
+    const float minRadius2 = 0.5;
+    const float fixedRadius2 = 1.;
+    if (r2 < minRadius2) return fixedRadius2 / minRadius2;
+    if (r2 < fixedRadius2) return fixedRadius2 / r2;
+    return 1.0;
+}
+
+// mandelboxDE at referencePoint + offset. The iteration carries the difference to the reference orbit,
+// so the offset keeps the bits a float position next to the reference point would round away
+float mandelboxPerturbedDE(vec3 offset, out vec3 trap)
+{
+    const float minRadius2 = 0.5;
+    const float fixedRadius2 = 1.;
+    vec3 delta = offset;
+    vec3 z = referenceOrbit[0] + offset;
     float dr = 1.0;
-    vec3 trap = vec3(0,0,0);
+    trap = vec3(1e20);
+
+    for (int i = 0; i < 20; i++)
+    {
+        if (i < referenceLength)
+        {
+            vec3 reference = referenceOrbit[i];
+
+            // Box fold, on the reference's side of the limit the difference is kept or mirrored, across it taken directly
+            vec3 side = sign(reference) * step(boxFoldLimit, abs(reference));
+            vec3 zSide = sign(z) * step(boxFoldLimit, abs(z));
+            vec3 folded = clamp(reference, -boxFoldLimit, boxFoldLimit) * 2.0 - reference;
+            vec3 zFolded = clamp(z, -boxFoldLimit, boxFoldLimit) * 2.0 - z;
+            delta = mix(zFolded - folded, delta * (1.0 - 2.0 * abs(side)), step(abs(side - zSide), vec3(0.5)));
+
+            // Sphere fold, the radius and scale changes come from the difference instead of subtracting close values
+            float r2Reference = dot(folded, folded);
+            float r2Change = dot(2.0 * folded + delta, delta);
+            float r2 = r2Reference + r2Change;
+            float scale = sphereFoldScale(r2);
+            bool inverted = r2Reference >= minRadius2 && r2Reference < fixedRadius2 && r2 >= minRadius2 && r2 < fixedRadius2;
+            float scaleChange = inverted ? -fixedRadius2 * r2Change / (r2 * r2Reference) : scale - sphereFoldScale(r2Reference);
+            delta = scale * delta + scaleChange * folded;
+            dr *= scale;
+
+            delta = boxScale * delta + offset;
+            z = referenceOrbit[i + 1] + delta;
+        }
+        else
+        {
+            // The reference escaped before this point, it continues in plain float
+            z = clamp(z, -boxFoldLimit, boxFoldLimit) * 2.0 - z;
+            float scale = sphereFoldScale(dot(z, z));
+            z *= scale;
+            dr *= scale;
+            z = boxScale * z + (referenceOrbit[0] + offset);
+        }
+
+        dr = dr * abs(boxScale) + 1.;
+        trap = min(trap, abs(z));
+
+        if (dot(z, z) > 10000.) break;
+    }
+    return length(z) / abs(dr);
+}
+
+#elif defined(FRACTAL_KLEINIAN)
+
+float kleinianDE(vec3 p, out vec3 trap)
+{
+    float dr = 1.0;
+    vec3 center = vec3(0,0,0);
     float dist = 2.;
     float dist2 = 1e10;
     p+=vec3(1,1,0);
@@ -36,37 +178,180 @@ float kleinianDE(vec3 p, inout float currentIter){
 
         p *= k;
         dr *= k;
-        dist = max(dist, length(p-trap));
-        dist2 = min(dist2, length(p-trap));
+        dist = max(dist, length(p-center));
+        dist2 = min(dist2, length(p-center));
     }
-    currentIter = mix(dist * 6.5, clamp(dist2 ,0. ,10.), 0.5);
+    trap = vec3(mix(dist * 6.5, clamp(dist2 ,0. ,10.), 0.5));
     return 0.25 * abs(p.y) / dr;
 }
 
-float mandelboxDE(vec3 p, inout float currentIter){
-    float minr2 = 0.5;
-    float fixedr2 = 1.;
+// Gradient of kleinianDE, the folds are translations and leave the Jacobian unchanged
+vec3 kleinianGradient(vec3 p)
+{
+    mat3 J = mat3(1.0);
+    float dr = 1.0;
+    vec3 drGradient = vec3(0.0);
+    p+=vec3(1,1,0);
+    for (int i = 0; i < 10; i++){
+        p = -1. + 2. * fract(0.5*p+0.5);
+        float r2 = dot(p, p);
+        if (length(p) > 2.) break;
+        float k = 1.5 / r2;
+
+        drGradient = drGradient * k - (p * J) * (2.0 * k * dr / r2);
+        J = (mat3(k) - outer(p, p) * (2.0 * k / r2)) * J;
+        p *= k;
+        dr *= k;
+    }
+    vec3 yGradient = vec3(J[0].y, J[1].y, J[2].y);
+    return normalize(yGradient * (0.25 * sign(p.y) / dr) - drGradient * (0.25 * abs(p.y) / (dr * dr)));
+}
+
+#else
+
+float mandelbulbDE(in vec3 p, out vec3 trap)
+{
     vec3 z = p;
     float dr = 1.0;
-    vec3 trap = vec3(0,0,0);
-    float dist = 2.;
-    float dist2 = 1e10;
-    for (int i = 0; i < 20; i++){
-        z = clamp(z, -u_foldlimit, u_foldlimit) * 2.0 - z; //Box fold
+    float r = 0.;
+    trap = vec3(1e20);
 
-        float r2 = dot(z,z);
-        if (r2 > 10000.) break;
-        if (length(z) < minr2 || r2 < fixedr2){
-            float temp = fixedr2 / r2;
-            z *= temp;
-            dr *= temp;
-        }
-        z = u_scale * z + p;
-        dr = dr * abs(u_scale) + 1.;
-        dist = max(dist, length(p-trap));
-        dist2 = min(dist2, length(p-trap));
+    for (int i = 0; i < 10; i++)
+    {
+        trap = min(trap, dot(z, z));
+
+        r = length(z);
+        if (r > 4.)
+        break;
+
+#ifdef POWER_8
+        // z^8 in closed triplex form, the same point as the polar form without acos, atan and pow
+        float r2 = r * r;
+        dr = 8. * r2 * r2 * r2 * r * dr + 1.;
+
+        float x = z.y; float x2 = x * x; float x4 = x2 * x2;
+        float y = z.z; float y2 = y * y; float y4 = y2 * y2;
+        float w = z.x; float w2 = w * w; float w4 = w2 * w2;
+
+        float k3 = x2 + w2;
+        float k2 = inversesqrt(k3 * k3 * k3 * k3 * k3 * k3 * k3);
+        float k1 = x4 + y4 + w4 - 6. * y2 * w2 - 6. * x2 * y2 + 2. * w2 * x2;
+        float k4 = x2 - y2 + w2;
+
+        z = p + vec3(
+            -8. * y * k4 * (x4 * x4 - 28. * x4 * x2 * w2 + 70. * x4 * w4 - 28. * x2 * w2 * w4 + w4 * w4) * k1 * k2,
+            64. * x * y * w * (x2 - w2) * k4 * (x4 - 6. * x2 * w2 + w4) * k1 * k2,
+            -16. * y2 * k3 * k4 * k4 + k1 * k1
+        );
+#else
+        float theta = acos(z.z / r) * power;
+        float phi = atan(z.y, z.x) * power;
+
+        dr = pow(r, power - 1.) * power * dr + 1.;
+        z = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)) * pow(r, power) + p;
+#endif
     }
-    currentIter = mix(dist, clamp(dist2,0. ,10.), 0.5);
-    float r = length(z);
-    return r / abs(dr);
-}
\ No newline at end of file
+    return 0.5 * log(r) * r / dr;
+}
+
+// Gradient of mandelbulbDE from the polar form, the Jacobian of z and the gradient of dr carried through the same iteration
+vec3 mandelbulbGradient(vec3 p)
+{
+#ifdef POWER_8
+    const float n = 8.;
+#else
+    float n = power;
+#endif
+    vec3 z = p;
+    mat3 J = mat3(1.0);
+    float dr = 1.0;
+    vec3 drGradient = vec3(0.0);
+    float r = 0.;
+    vec3 rGradient = vec3(0.0);
+
+    for (int i = 0; i < 10; i++)
+    {
+        r = length(z);
+        rGradient = (z * J) / r;
+        if (r > 4.)
+        break;
+
+        // Gradients of the angles through the rows of J
+        vec3 xGradient = vec3(J[0].x, J[1].x, J[2].x);
+        vec3 yGradient = vec3(J[0].y, J[1].y, J[2].y);
+        vec3 zGradient = vec3(J[0].z, J[1].z, J[2].z);
+        float c = z.z / r;
+        vec3 thetaGradient = -(zGradient * r - rGradient * z.z) / (r * r * sqrt(max(1. - c * c, 1e-12)));
+        vec3 phiGradient = (yGradient * z.x - xGradient * z.y) / max(dot(z.xy, z.xy), 1e-30);
+
+        float theta = acos(c) * n;
+        float phi = atan(z.y, z.x) * n;
+        float rn1 = pow(r, n - 1.);
+        float rn = rn1 * r;
+
+        drGradient = rGradient * (n * (n - 1.) * pow(r, n - 2.) * dr) + drGradient * (n * rn1);
+        dr = rn1 * n * dr + 1.;
+
+        vec3 s = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+        vec3 sTheta = vec3(cos(theta) * cos(phi), cos(theta) * sin(phi), -sin(theta));
+        vec3 sPhi = vec3(-sin(theta) * sin(phi), sin(theta) * cos(phi), 0.);
+        J = outer(s, rGradient * (n * rn1)) + outer(sTheta, thetaGradient * (n * rn)) + outer(sPhi, phiGradient * (n * rn)) + mat3(1.0);
+        z = s * rn + p;
+    }
+    float logR = log(r);
+    return normalize(rGradient * (0.5 * (logR + 1.) / dr) - drGradient * (0.5 * logR * r / (dr * dr)));
+}
+
+#endif
+
+// Distances along a unit ray where it enters and leaves the volume that holds the fractal, false if it misses
+bool fractalBounds(vec3 origin, vec3 dir, out vec2 range)
+{
+#if defined(FRACTAL_MANDELBOX)
+    // Axis-aligned cube, slabs of the three axes
+    vec3 inverse = 1.0 / (dir + vec3(1e-8) * step(abs(dir), vec3(1e-8)));
+    vec3 t0 = (-boundingExtent - origin) * inverse;
+    vec3 t1 = (boundingExtent - origin) * inverse;
+    vec3 tMin = min(t0, t1);
+    vec3 tMax = max(t0, t1);
+    range = vec2(max(max(tMin.x, tMin.y), max(tMin.z, 0.0)), min(min(tMax.x, tMax.y), tMax.z));
+    return range.x <= range.y;
+#elif defined(FRACTAL_KLEINIAN)
+    // Unbounded
+    range = vec2(0.0, maxDistance);
+    return true;
+#else
+    // Sphere around the origin
+    float b = dot(origin, dir);
+    float c = dot(origin, origin) - boundingExtent * boundingExtent;
+    float h = b * b - c;
+    range = vec2(0.0);
+    if (h < 0.0) return false;
+    h = sqrt(h);
+    range = vec2(max(-b - h, 0.0), -b + h);
+    return range.y > 0.0;
+#endif
+}
+
+float fractalDE(vec3 p, out vec3 trap)
+{
+#if defined(FRACTAL_MANDELBOX)
+    return mandelboxDE(p, trap);
+#elif defined(FRACTAL_KLEINIAN)
+    return kleinianDE(p, trap);
+#else
+    return mandelbulbDE(p, trap);
+#endif
+}
+
+// Normalised gradient of the compiled estimator, the surface normal without extra estimator calls
+vec3 fractalGradient(vec3 p)
+{
+#if defined(FRACTAL_MANDELBOX)
+    return mandelboxGradient(p);
+#elif defined(FRACTAL_KLEINIAN)
+    return kleinianGradient(p);
+#else
+    return mandelbulbGradient(p);
+#endif
+}
@@ -0,0 +1,35 @@
+uniform sampler2D counters;         // steps, shadow steps, normal DE calls, total DE calls
+uniform int channel;
+uniform float maxValue;
+
+// Polynomial fit of the Turbo colour map
+vec3 turbo(float x)
+{
+    const vec4 red4 = vec4(0.13572138, 4.61539260, -42.66032258, 132.13108234);
+    const vec4 green4 = vec4(0.09140261, 2.19418839, 4.84296658, -14.18503333);
+    const vec4 blue4 = vec4(0.10667330, 12.64194608, -60.58204836, 110.36276771);
+    const vec2 red2 = vec2(-152.94239396, 59.28637943);
+    const vec2 green2 = vec2(4.27729857, 2.82956604);
+    const vec2 blue2 = vec2(-89.90310912, 27.34824973);
+
+    x = clamp(x, 0.0, 1.0);
+    vec4 v4 = vec4(1.0, x, x * x, x * x * x);
+    vec2 v2 = v4.zw * v4.z;
+    return vec3(
+        dot(v4, red4) + dot(v2, red2),
+        dot(v4, green4) + dot(v2, green2),
+        dot(v4, blue4) + dot(v2, blue2)
+    );
+}
+
+void main()
+{
+    vec4 count = texture2D(counters, gl_TexCoord[0].xy);
+
+    float value = count.r;
+    if (channel == 1) value = count.g;
+    else if (channel == 2) value = count.b;
+    else if (channel == 3) value = count.a;
+
+    gl_FragColor = vec4(turbo(value / maxValue), 1.0);
+}
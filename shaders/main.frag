@@ -1,21 +1,75 @@
+#include "common.glsl"
+#include "estimators.glsl"
+#include "sampler.glsl"
+
 uniform vec2 iResolution;
+uniform vec2 tileOrigin;            // Pixel offset of the render target in the image, non-zero for poster tiles
+
+#ifdef CAMERA_UBO
+// Per-frame camera state, std140 layout mirrored by UniformCache
+layout(std140) uniform Camera {
+    mat3 camRotationMatrix;
+    vec3 camPosition;
+    float fov;
+    float aperture;
+    float focusDistance;
+    float iTime;
+    float sampleIndex;
+    vec3 referencePoint;
+    float detailScale;
+};
+#else
 uniform vec3 camPosition;
 uniform mat3 camRotationMatrix;
 uniform float fov;
-
-uniform float power;
+uniform float aperture;
+uniform float focusDistance;
 uniform float iTime;
-uniform float epsilon;
-uniform float maxDistance;
-uniform int iterations;
+uniform float sampleIndex;          // Index into the low-discrepancy sequences of sampler.glsl
+uniform vec3 referencePoint;        // Deep zoom origin of every position in this shader, zero otherwise
+uniform float detailScale;          // Smallest visible detail relative to zoom 1, below 1 in deep zoom
+#endif
 
-uniform sampler2D lastFrame;
+uniform sampler2D lastFrame;        // RGB colour, alpha holds the camera distance
+uniform vec2 historySize;           // Pixel size of lastFrame
 uniform float blendFactor;
 uniform bool accumulate;
 
-uniform vec2 jitter;
-uniform float aperture;
-uniform float focusDistance;
+// Camera that rendered lastFrame
+uniform bool reproject;
+uniform vec3 prevCamPosition;
+uniform mat3 prevCamRotationMatrix;
+uniform float prevFov;
+
+// Cone pre-pass
+uniform int passMode;               // 0 = shading, 1 = cone pre-pass, 2 = diagnostic counters, 3 = surface normals
+uniform bool useConeDistance;
+uniform sampler2D coneDistance;     // Conservative start distances of the coarser level
+uniform vec2 coneTextureSize;
+uniform float coneScale;            // Pixels of this pass per cone texel
+
+// Estimator baked over the bounding cube for the lighting rays, primary rays keep the exact one
+uniform bool useDistanceVolume;
+uniform sampler3D distanceVolume;
+uniform float volumeExtent;         // Half-size of the cube the volume covers
+uniform float volumeTexel;          // Grid spacing of the volume
+
+// Normal estimation at the hit point
+uniform int normalMode;             // 0 = central differences, 1 = tetrahedron, 2 = forward differences, 3 = analytic gradient
+
+// Diagnostics
+uniform bool outputSteps;
+
+const float coneRange = 64.0;
+
+// Surface distance of this zoom and the light relative to the reference point, set in main()
+float surfaceEpsilon;
+vec3 lightPosition;
+
+// Number of distance estimator evaluations of this fragment
+int deCalls;
+int shadowSteps;
+int normalCalls;
 
 struct HitInfo {
     bool hit;
@@ -26,18 +80,8 @@ struct HitInfo {
     int steps;
 };
 
-vec2 hash2(vec2 p) {
-    // Large constants = better scrambling
-    const float K1 = 0.3183099; // 1/π
-    const float K2 = 0.3678794; // 1/e
-
-    p = fract(p * vec2(K1, K2));
-    p += dot(p, p.yx + 19.19); // scrambled feedback
-    return fract(vec2(p.x * p.y * 95.233, p.x + p.y * 11.472));
-}
-
-vec2 sampleDisk(vec2 seed) {
-    vec2 rnd = hash2(seed);
+// Uniform point on the unit disk from a sample in [0, 1)^2
+vec2 sampleDisk(vec2 rnd) {
     float angle = rnd.x * 6.2831853;
     float radius = sqrt(rnd.y);
     return vec2(cos(angle), sin(angle)) * radius;
@@ -45,31 +89,55 @@ vec2 sampleDisk(vec2 seed) {
 
 float distanceEstimator(in vec3 p, out vec3 trap)
 {
-    vec3 z = p;
-    float dr = 1.0;
-    float r = 0.;
-    trap = vec3(1e20);
+    deCalls++;
+#if defined(FRACTAL_MANDELBOX)
+    if (referenceLength > 0) return mandelboxPerturbedDE(p, trap);
+#endif
+    return fractalDE(p, trap);
+}
 
-    for (int i = 0; i < 10; i++)
-    {
-        trap = min(trap, dot(z, z));
+// Distance for shadow and AO rays, a texture lookup where the volume is baked
+float lightingDistance(vec3 p)
+{
+    if (useDistanceVolume)
+        return texture3D(distanceVolume, p / (2.0 * volumeExtent) + 0.5).r;
 
-        r = length(z);
-        if (r > 4.)
-        break;
+    vec3 trap;
+    return distanceEstimator(p, trap);
+}
 
-        float theta = acos(z.z / r) * power;
-        float phi = atan(z.y, z.x) * power;
+// hitDistance is the estimate the march stopped at, the forward differences reuse it
+vec3 surfaceNormal(vec3 p, float hitDistance) {
+    float h = surfaceEpsilon;
+    vec3 dummyTrap;
 
-        dr = pow(r, power - 1.) * power * dr + 1.;
-        z = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)) * pow(r, power) + p;
+    if (normalMode == 1) {
+        // Corners of a tetrahedron, the opposite taps cancel the constant term
+        normalCalls += 4;
+        const vec2 k = vec2(1.0, -1.0);
+        return normalize(
+            k.xyy * distanceEstimator(p + k.xyy * h, dummyTrap) +
+            k.yyx * distanceEstimator(p + k.yyx * h, dummyTrap) +
+            k.yxy * distanceEstimator(p + k.yxy * h, dummyTrap) +
+            k.xxx * distanceEstimator(p + k.xxx * h, dummyTrap)
+        );
+    }
+    if (normalMode == 2) {
+        normalCalls += 3;
+        return normalize(vec3(
+            distanceEstimator(p + vec3(h, 0, 0), dummyTrap) - hitDistance,
+            distanceEstimator(p + vec3(0, h, 0), dummyTrap) - hitDistance,
+            distanceEstimator(p + vec3(0, 0, h), dummyTrap) - hitDistance
+        ));
+    }
+    if (normalMode == 3) {
+        // One pass through the iteration, counted as one estimator call
+        normalCalls += 1;
+        deCalls++;
+        return fractalGradient(p);
     }
-    return 0.5 * log(r) * r / dr;
-}
 
-vec3 surfaceNormal(vec3 p) {
-    float h = epsilon;
-    vec3 dummyTrap;
+    normalCalls += 6;
     return normalize(vec3(
         distanceEstimator(p + vec3(h, 0, 0), dummyTrap) - distanceEstimator(p - vec3(h, 0, 0), dummyTrap),
         distanceEstimator(p + vec3(0, h, 0), dummyTrap) - distanceEstimator(p - vec3(0, h, 0), dummyTrap),
@@ -88,11 +156,18 @@ vec3 computeRayDirection(vec2 uv)
     return camRotationMatrix * dir;
 }
 
-HitInfo raymarch(vec3 rayOrigin, vec3 rayDir) {
+HitInfo raymarch(vec3 rayOrigin, vec3 rayDir, float startDistance) {
     HitInfo info;
     info.hit = false;
     info.trapColor = vec3(0, 0, 0);
-    info.distance = 0.0;
+    info.distance = startDistance;
+    info.steps = 0;
+
+    // Rays that miss the bounding volume are sky, the others start marching where they enter it
+    vec2 bounds;
+    if (!fractalBounds(referencePoint + rayOrigin, rayDir, bounds)) return info;
+    info.distance = max(startDistance, bounds.x);
+    float farDistance = min(bounds.y, maxDistance);
 
     float totalDist = 0.0;
     vec3 p;
@@ -110,14 +185,14 @@ HitInfo raymarch(vec3 rayOrigin, vec3 rayDir) {
 
         info.distance += d;
 
-        if (d < epsilon) {
+        if (d < surfaceEpsilon) {
             info.hit = true;
             info.position = p;
             info.trapColor = trap;
-            info.normal = surfaceNormal(p);
+            info.normal = surfaceNormal(p, d);
             break;
         }
-        if (info.distance > maxDistance) {
+        if (info.distance > farDistance) {
             break;
         }
     }
@@ -126,25 +201,33 @@ HitInfo raymarch(vec3 rayOrigin, vec3 rayDir) {
     return info;
 }
 
-float shadowFactor(HitInfo info, vec3 lightPos, float w) {
+// startOffset dithers the first step across samples, which hides the banding of the fixed step clamp
+float shadowFactor(HitInfo info, vec3 lightPos, float w, float startOffset) {
     if (!info.hit) return 1.0;
 
     vec3 lightDir = normalize(lightPos - info.position);
-    vec3 shadowOrigin = info.position + info.normal * epsilon;
+    vec3 shadowOrigin = info.position + info.normal * surfaceEpsilon;
     float maxDist = length(lightPos - info.position);
-    float distance = 0;
+    float distance = startOffset;
+
+    // Nothing casts a shadow past the exit of the bounding volume
+    vec2 bounds;
+    if (fractalBounds(referencePoint + shadowOrigin, lightDir, bounds)) maxDist = min(maxDist, bounds.y);
+
+    // The volume does not resolve the surface itself, its own texels would shadow it
+    if (useDistanceVolume) distance += 2.0 * volumeTexel;
 
     float factor = 1.0;
 
     for (int i = 0; i < 128; i++) {
+        shadowSteps++;
         vec3 p = shadowOrigin + lightDir * distance;
 
-        vec3 trap;
-        float d = distanceEstimator(p, trap);
+        float d = lightingDistance(p);
 
         factor = min(factor, d / (w * distance));
 
-        distance += clamp(d, 0.005, 0.50);
+        distance += clamp(d, 500.0 * surfaceEpsilon, 0.50);
 
         if (factor < -1.0 || distance > maxDist) break;
     }
@@ -154,18 +237,139 @@ float shadowFactor(HitInfo info, vec3 lightPos, float w) {
     return 0.25*(1.0+factor)*(1.0+factor)*(2.0-factor);
 }
 
-vec3 renderPixel(vec2 fragCoord)
+// Five taps along the normal, each missing distance to the surface darkens, offset per sample when accumulating
+float ambientOcclusion(HitInfo info, float offset)
+{
+    if (!info.hit) return 1.0;
+
+    float occlusion = 0.0;
+    float weight = 1.0;
+    for (int i = 0; i < 5; i++) {
+        float h = (float(i) + offset) * 1.5 * volumeTexel;
+        occlusion += (h - lightingDistance(info.position + info.normal * h)) * weight;
+        weight *= 0.6;
+    }
+    return clamp(1.0 - occlusion / (4.0 * volumeTexel), 0.0, 1.0);
+}
+
+// 24-bit fixed point over [0, coneRange), rounded down so the decoded value never overshoots
+vec3 packDistance(float t)
+{
+    float v = floor(clamp(t / coneRange, 0.0, 1.0) * 16777215.0);
+    float high = floor(v / 65536.0);
+    float middle = floor((v - high * 65536.0) / 256.0);
+    float low = v - high * 65536.0 - middle * 256.0;
+    return vec3(high, middle, low) / 255.0;
+}
+
+float unpackDistance(vec3 rgb)
+{
+    vec3 bytes = floor(rgb * 255.0 + 0.5);
+    return (bytes.x * 65536.0 + bytes.y * 256.0 + bytes.z) / 16777215.0 * coneRange;
+}
+
+vec4 encodeCount(int count)
+{
+    float c = float(count);
+    return vec4(floor(c / 256.0) / 255.0, mod(c, 256.0) / 255.0, 0.0, 1.0);
+}
+
+// Start distance of this pixel from the coarser level, maxDistance if the whole cone escaped
+float sampleConeDistance(vec2 fragCoord)
+{
+    vec4 cone = texture2D(coneDistance, (floor(fragCoord / coneScale) + 0.5) / coneTextureSize);
+    if (cone.a > 0.5) return maxDistance;
+
+    // Slack for the 8-bit round trip
+    return unpackDistance(cone.rgb) * 0.999;
+}
+
+// Marches one cone per coarse pixel, covering the pixel footprint, the jitter and the lens
+vec4 conePass(vec2 fragCoord)
+{
+    float t = useConeDistance ? sampleConeDistance(fragCoord) : 0.0;
+    if (t >= maxDistance) return vec4(0.0, 0.0, 0.0, 1.0);
+
+    vec3 rayDir = computeRayDirection(fragCoord / iResolution);
+
+    // Half-diagonal of the coarse pixel plus a full resolution pixel of jitter
+    float spread = tan(fov * 0.5) * 2.1213203 / iResolution.y;
+    bool escaped = false;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        vec3 trap;
+        float d = distanceEstimator(camPosition + rayDir * t, trap);
+        float radius = t * spread + aperture * (1.0 + t / focusDistance);
+
+        // The surface may be inside the cone
+        if (d < 2.0 * radius) break;
+
+        t += d - radius;
+        if (t > maxDistance) {
+            escaped = true;
+            break;
+        }
+    }
+
+    if (outputSteps) return encodeCount(deCalls);
+    return vec4(packDistance(t), escaped ? 1.0 : 0.0);
+}
+
+// Finds this surface point (or sky direction) in lastFrame, false when it was off-screen or occluded there
+bool reprojectHistory(HitInfo info, vec3 rayDir, out vec2 historyUv)
+{
+    vec3 local = info.hit ? (info.position - prevCamPosition) * prevCamRotationMatrix : rayDir * prevCamRotationMatrix;
+    historyUv = vec2(0.0);
+    if (local.z <= 0.0) return false;
+
+    vec2 ndc = local.xy / (local.z * tan(prevFov * 0.5));
+    ndc.x /= iResolution.x / iResolution.y;
+    historyUv = ndc * 0.5 + 0.5;
+    if (any(lessThan(historyUv, vec2(0.0))) || any(greaterThan(historyUv, vec2(1.0)))) return false;
+
+    // Disocclusion: the previous frame must have seen the same depth at that pixel
+    float historyDepth = texture2D(lastFrame, historyUv).a;
+    if (!info.hit) return historyDepth >= maxDistance * 0.5;
+
+    float expectedDepth = length(info.position - prevCamPosition);
+    return abs(historyDepth - expectedDepth) < 0.05 * expectedDepth;
+}
+
+// Per-pixel march cost for the heatmaps, needs a float target
+vec4 diagnosticPass(vec2 fragCoord)
+{
+    vec3 rayDir = computeRayDirection(fragCoord / iResolution);
+    float startDistance = useConeDistance ? sampleConeDistance(fragCoord) : 0.0;
+    HitInfo info = raymarch(camPosition, rayDir, startDistance);
+    shadowFactor(info, lightPosition, 0.05, 0.0);
+
+    return vec4(float(info.steps), float(shadowSteps), float(normalCalls), float(deCalls));
+}
+
+// Normal of the primary hit for comparing the normal estimators, needs a float target
+vec4 normalPass(vec2 fragCoord)
+{
+    vec3 rayDir = computeRayDirection(fragCoord / iResolution);
+    float startDistance = useConeDistance ? sampleConeDistance(fragCoord) : 0.0;
+    HitInfo info = raymarch(camPosition, rayDir, startDistance);
+
+    return info.hit ? vec4(info.normal, 1.0) : vec4(0.0);
+}
+
+vec4 renderPixel(vec2 fragCoord)
 {
     vec2 texUv = fragCoord / iResolution;
-    // Jittered UV for accumulation
-    vec2 jitteredUv = accumulate ? texUv + jitter : texUv;
+    // Jittered UV for accumulation, a different sub-pixel position for every sample index
+    vec2 pixelOffset = accumulate ? sample2D(fragCoord, sampleIndex, SAMPLE_PIXEL) - 0.5 : vec2(0.0);
+    vec2 jitteredUv = texUv + pixelOffset / iResolution;
     vec3 rayOrigin = camPosition;
     vec3 rayDir = computeRayDirection(jitteredUv);
 
     // Depth of Field
     if (accumulate) {
         vec3 focusPoint = rayOrigin + rayDir * focusDistance;
-        vec2 lensSample = sampleDisk(fragCoord + iTime) * aperture;
+        vec2 lensSample = sampleDisk(sample2D(fragCoord, sampleIndex, SAMPLE_LENS)) * aperture;
 
         vec3 dofOffset = camRotationMatrix * vec3(lensSample, 0.0);
 
@@ -173,26 +377,65 @@ vec3 renderPixel(vec2 fragCoord)
         rayDir = normalize(focusPoint - rayOrigin);
     }
 
-    HitInfo info = raymarch(rayOrigin, rayDir);
+    float startDistance = useConeDistance ? sampleConeDistance(fragCoord) : 0.0;
+    HitInfo info = raymarch(rayOrigin, rayDir, startDistance);
 
     // Get shadow
-    float shadow = shadowFactor(info, vec3(100, 100, -10), 0.05);
+    float shadowOffset = accumulate ? sample1D(fragCoord, sampleIndex, SAMPLE_SHADOW) * 500.0 * surfaceEpsilon : 0.0;
+    float shadow = shadowFactor(info, lightPosition, 0.05, shadowOffset);
 
-    float shade = float(info.steps) / float(iterations);
     vec3 color = mix(info.normal, vec3(0.529, 0.808, 0.922), (info.hit ? 0.0 : 1.0));
     color *= shadow;
 
+    // Occlusion is only affordable with the volume
+    if (useDistanceVolume) {
+        float aoOffset = accumulate ? sample1D(fragCoord, sampleIndex, SAMPLE_AO) : 0.5;
+        color *= ambientOcclusion(info, 0.5 + aoOffset);
+    }
+
     // Temporal accumulation
     if (accumulate) {
-        vec3 prevColor = texture(lastFrame, texUv).rgb;
-        color = mix(color, prevColor, blendFactor);
+        vec2 historyUv = (fragCoord - tileOrigin) / historySize;
+        bool historyValid = true;
+        if (reproject) {
+            // Reprojecting the pixel centre rather than the jittered sample, so the history does not drift
+            historyValid = reprojectHistory(info, rayDir, historyUv);
+            historyUv -= jitteredUv - texUv;
+        }
+
+        if (historyValid) {
+            vec3 prevColor = texture2D(lastFrame, historyUv).rgb;
+            color = mix(color, prevColor, blendFactor);
+        }
     }
 
-    return color;
+    float depth = info.hit ? length(info.position - camPosition) : maxDistance;
+    return vec4(color, depth);
 }
 
 void main()
 {
-    vec3 finalColor = renderPixel(gl_FragCoord.xy);
-    gl_FragColor = vec4(finalColor, 1.0);
+    deCalls = 0;
+    shadowSteps = 0;
+    normalCalls = 0;
+    surfaceEpsilon = epsilon * detailScale;
+    lightPosition = vec3(100, 100, -10) - referencePoint;
+
+    vec2 fragCoord = gl_FragCoord.xy + tileOrigin;
+
+    if (passMode == 1) {
+        gl_FragColor = conePass(fragCoord);
+        return;
+    }
+    if (passMode == 2) {
+        gl_FragColor = diagnosticPass(fragCoord);
+        return;
+    }
+    if (passMode == 3) {
+        gl_FragColor = normalPass(fragCoord);
+        return;
+    }
+
+    vec4 finalColor = renderPixel(fragCoord);
+    gl_FragColor = outputSteps ? encodeCount(deCalls) : finalColor;
 }
\ No newline at end of file
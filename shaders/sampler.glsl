@@ -0,0 +1,33 @@
+// Low-discrepancy samples per pixel and sample index, provided by Sampler
+#include "common.glsl"
+
+uniform sampler2D blueNoise;        // Void-and-cluster ranks, two independent channels
+uniform vec2 blueNoiseSize;
+uniform vec2 samplerScramble;       // Rotation shared by every pixel, changes with the seed
+
+// Sample dimensions, every one reads the blue noise at its own offset so they stay decorrelated
+const int SAMPLE_PIXEL = 0;
+const int SAMPLE_LENS = 1;
+const int SAMPLE_SHADOW = 2;
+const int SAMPLE_AO = 3;
+
+// R2 sequence, the generalised golden ratio in two dimensions
+const vec2 R2 = vec2(0.7548776662, 0.5698402910);
+const float R1 = 0.6180339887;
+
+vec2 blueNoiseOffset(vec2 fragCoord, int dimension)
+{
+    vec2 shift = float(dimension) * vec2(23.0, 41.0);
+    return texture2D(blueNoise, (floor(fragCoord) + shift + 0.5) / blueNoiseSize).rg;
+}
+
+// Sample index sampleIndex of this pixel in [0, 1)^2
+vec2 sample2D(vec2 fragCoord, float sampleIndex, int dimension)
+{
+    return fract(blueNoiseOffset(fragCoord, dimension) + samplerScramble + sampleIndex * R2);
+}
+
+float sample1D(vec2 fragCoord, float sampleIndex, int dimension)
+{
+    return fract(blueNoiseOffset(fragCoord, dimension).r + samplerScramble.x + sampleIndex * R1);
+}
@@ -0,0 +1,16 @@
+// Bakes one layer of the distance volume, see DistanceVolume
+#include "estimators.glsl"
+
+uniform float volumeExtent;         // Half-size of the cube around the origin
+uniform float volumeSize;           // Texels along every axis
+uniform float volumeSlice;          // Layer of this draw
+
+void main()
+{
+    // Texel centres, matching the trilinear lookup in main.frag
+    vec3 texel = vec3(gl_FragCoord.xy, volumeSlice + 0.5);
+    vec3 p = (texel / volumeSize * 2.0 - 1.0) * volumeExtent;
+
+    vec3 trap;
+    gl_FragColor = vec4(fractalDE(p, trap), 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,170 @@
+#include "animation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "camera.hpp"
+#include "camerapath.hpp"
+#include "imagewriter.hpp"
+#include "renderer.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace
+{
+    // frames/shot.png becomes frames/shot_000042.png
+    std::filesystem::path getFramePath(const std::filesystem::path &pattern, const std::uint32_t frame)
+    {
+        std::ostringstream name;
+        name << pattern.stem().string() << "_" << std::setw(6) << std::setfill('0') << frame << pattern.extension().string();
+        return pattern.parent_path() / name.str();
+    }
+
+    bool writeFrame(const std::filesystem::path &path, const sf::Vector2u &size, const std::vector<float> &texels)
+    {
+        const std::unique_ptr<raymarch::ImageStreamWriter> writer = raymarch::createImageWriter(path, size);
+        if (!writer) return false;
+
+        // Texel rows are bottom-up, alpha holds the depth
+        std::vector<float> row(static_cast<std::size_t>(size.x) * 3);
+        for (unsigned int i = 0; i < size.y; ++i)
+        {
+            const unsigned int y = writer->isBottomUp() ? i : size.y - 1 - i;
+            const float* source = texels.data() + static_cast<std::size_t>(y) * size.x * 4;
+            for (unsigned int x = 0; x < size.x; ++x)
+                std::copy_n(source + x * 4, 3, row.data() + x * 3);
+
+            if (!writer->writeRow(row.data())) return false;
+        }
+        return writer->finish();
+    }
+
+    // Raw rgb24, top row first, as ffmpeg -f rawvideo expects it
+    bool pipeFrame(std::FILE* pipe, const sf::Vector2u &size, const std::vector<float> &texels)
+    {
+        std::vector<std::uint8_t> row(static_cast<std::size_t>(size.x) * 3);
+        for (unsigned int i = 0; i < size.y; ++i)
+        {
+            const float* source = texels.data() + static_cast<std::size_t>(size.y - 1 - i) * size.x * 4;
+            for (unsigned int x = 0; x < size.x; ++x)
+                for (int channel = 0; channel < 3; ++channel)
+                    row[x * 3 + channel] = static_cast<std::uint8_t>(std::clamp(source[x * 4 + channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+            if (std::fwrite(row.data(), 1, row.size(), pipe) != row.size()) return false;
+        }
+        return true;
+    }
+}
+
+raymarch::AnimationRenderer::AnimationRenderer(const Options &options) :
+    _options(options)
+{
+}
+
+int raymarch::AnimationRenderer::run() const
+{
+    CameraPath path;
+    if (!path.load(_options.cameraPath)) return 1;
+    if (path.isEmpty())
+    {
+        std::cerr << "Camera path " << _options.cameraPath << " has no keyframes" << std::endl;
+        return 1;
+    }
+
+    if (!sf::Shader::isAvailable())
+    {
+        std::cerr << "Shaders are not supported by the current GL context" << std::endl;
+        return 1;
+    }
+
+    const sf::Vector2u size = _options.resolution;
+    Renderer renderer {size};
+    renderer.setDistanceVolume(_options.distanceVolume);
+    if (!renderer.loadShader("shaders/main.frag")) return 1;
+
+    FractalParameters parameters = renderer.getParameters();
+    parameters.fractal = _options.fractal;
+    parameters.normals = _options.normals;
+    renderer.setParameters(parameters);
+    renderer.seed(_options.seed);
+    renderer.setConePrepass(false);
+
+    // Frames go to the encoder's stdin, or to numbered files next to the output pattern
+    std::FILE* pipe = nullptr;
+    if (!_options.pipeCommand.empty())
+    {
+#ifdef _WIN32
+        pipe = popen(_options.pipeCommand.c_str(), "wb");
+#else
+        pipe = popen(_options.pipeCommand.c_str(), "w");
+#endif
+        if (!pipe)
+        {
+            std::cerr << "Failed to start encoder: " << _options.pipeCommand << std::endl;
+            return 1;
+        }
+    }
+    else if (_options.outputPath.has_parent_path())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(_options.outputPath.parent_path(), error);
+    }
+
+    const float start = path.getStartTime();
+    const auto frameCount = static_cast<std::uint32_t>(std::floor(path.getDuration() * static_cast<float>(_options.frameRate))) + 1;
+
+    std::cout << "Rendering " << frameCount << " frames at " << size.x << "x" << size.y << ", " << _options.frameRate
+              << " fps with " << _options.samples << " samples per pixel" << std::endl;
+
+    Camera camera { static_cast<sf::Vector2f>(size), {0.001, 0, -4}, {0, 0, 2}, 90, 1.0f };
+    camera.setDeepZoom(_options.deepZoom);
+    const sf::IntRect frameArea {{0, 0}, static_cast<sf::Vector2i>(size)};
+
+    sf::Clock clock;
+    bool success = true;
+    for (std::uint32_t frame = 0; frame < frameCount && success; ++frame)
+    {
+        camera.setState(path.sample(start + static_cast<float>(frame) / static_cast<float>(_options.frameRate)));
+
+        const std::vector<float> texels = renderer.renderRegion(camera, size, frameArea, _options.samples);
+        if (texels.empty())
+        {
+            success = false;
+            break;
+        }
+
+        if (pipe)
+        {
+            success = pipeFrame(pipe, size, texels);
+            if (!success)
+                std::cerr << "Encoder stopped accepting frames" << std::endl;
+        }
+        else
+        {
+            const std::filesystem::path framePath = getFramePath(_options.outputPath, frame);
+            success = writeFrame(framePath, size, texels);
+            if (!success)
+                std::cerr << "Failed to write " << framePath << std::endl;
+        }
+
+        std::cout << "Frame " << frame + 1 << "/" << frameCount << " done after " << std::fixed << std::setprecision(1)
+                  << clock.getElapsedTime().asSeconds() << " s" << std::endl;
+    }
+
+    // The encoder finishes the file once its input is closed
+    if (pipe && pclose(pipe) != 0)
+    {
+        std::cerr << "Encoder exited with an error" << std::endl;
+        success = false;
+    }
+
+    return success ? 0 : 1;
+}
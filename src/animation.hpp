@@ -0,0 +1,16 @@
+#pragma once
+
+#include "options.hpp"
+
+namespace raymarch
+{
+    // Plays a recorded camera path headless at a fixed sample count per frame, into an image sequence or an encoder
+    class AnimationRenderer
+    {
+    public:
+        explicit AnimationRenderer(const Options& options);
+        int run() const;
+    private:
+        const Options& _options;
+    };
+}
@@ -0,0 +1,311 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <utility>
+
+#include "camera.hpp"
+#include "config.hpp"
+#include "cpurenderer.hpp"
+#include "renderer.hpp"
+
+namespace
+{
+    constexpr float PI = 3.1415927f;
+    constexpr float benchmarkTimeStep = 1.0f / 60.0f;
+
+    // Fixed camera path: a quarter orbit around the bulb, then holding still so the accumulation branch is measured too
+    bool applyCameraPath(raymarch::Camera& camera, const uint32_t frame, const uint32_t frames)
+    {
+        const uint32_t orbitFrames = std::max(1u, frames / 2);
+        const float t = std::min(1.0f, static_cast<float>(frame) / static_cast<float>(orbitFrames));
+        const float angle = t * PI * 0.5f;
+
+        camera.setPosition({4.0f * std::sin(angle) + 0.001f, 0.5f * std::sin(angle), -4.0f * std::cos(angle)});
+        camera.lookAt({0, 0, 0});
+
+        return frame < orbitFrames;
+    }
+
+    double percentile(const std::vector<double>& sorted, const double p)
+    {
+        // Nearest-rank percentile
+        const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    void writeStatistics(std::ostream& out, const raymarch::FrameStatistics& stats)
+    {
+        out << "{\"count\": " << stats.count
+            << ", \"mean_ms\": " << stats.mean
+            << ", \"stddev_ms\": " << stats.stddev
+            << ", \"min_ms\": " << stats.min
+            << ", \"p50_ms\": " << stats.p50
+            << ", \"p90_ms\": " << stats.p90
+            << ", \"p95_ms\": " << stats.p95
+            << ", \"p99_ms\": " << stats.p99
+            << ", \"max_ms\": " << stats.max
+            << ", \"fps\": " << (stats.mean > 0 ? 1000.0 / stats.mean : 0.0) << "}";
+    }
+
+    void printStatistics(const char* label, const raymarch::FrameStatistics& stats)
+    {
+        if (stats.count == 0) return;
+
+        std::cout << std::left << std::setw(14) << label << std::right << std::fixed << std::setprecision(3)
+                  << " mean " << std::setw(9) << stats.mean
+                  << "  p50 " << std::setw(9) << stats.p50
+                  << "  p95 " << std::setw(9) << stats.p95
+                  << "  p99 " << std::setw(9) << stats.p99
+                  << "  max " << std::setw(9) << stats.max << " ms" << std::endl;
+    }
+}
+
+raymarch::FrameStatistics raymarch::FrameStatistics::fromSamples(std::vector<double> samples)
+{
+    FrameStatistics stats;
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    stats.count = samples.size();
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(stats.count);
+
+    double variance = 0;
+    for (const double sample : samples)
+        variance += (sample - stats.mean) * (sample - stats.mean);
+    stats.stddev = std::sqrt(variance / static_cast<double>(stats.count));
+
+    stats.min = samples.front();
+    stats.p50 = percentile(samples, 50);
+    stats.p90 = percentile(samples, 90);
+    stats.p95 = percentile(samples, 95);
+    stats.p99 = percentile(samples, 99);
+    stats.max = samples.back();
+
+    return stats;
+}
+
+raymarch::Benchmark::Benchmark(const Options &options) :
+    _options(options)
+{
+    _samples.reserve(options.frames);
+}
+
+int raymarch::Benchmark::run()
+{
+    std::optional<Renderer> renderer;
+    std::optional<CpuRenderer> cpuRenderer;
+
+    if (_options.cpu)
+    {
+        cpuRenderer.emplace(_options.resolution, _options.threads);
+    }
+    else
+    {
+        if (!sf::Shader::isAvailable())
+        {
+            std::cerr << "Shaders are not supported by the current GL context" << std::endl;
+            return 1;
+        }
+
+        renderer.emplace(_options.resolution);
+        renderer->setDistanceVolume(_options.distanceVolume);
+        if (!renderer->loadShader("shaders/main.frag")) return 1;
+
+        FractalParameters parameters = renderer->getParameters();
+        parameters.fractal = _options.fractal;
+        parameters.normals = _options.normals;
+        renderer->setParameters(parameters);
+        renderer->seed(_options.seed);
+        renderer->setConePrepass(_options.conePrepass);
+        renderer->setReprojection(config::reprojection);
+
+        // Still frames keep marching every pixel, an early-out or skipped tiles would time the convergence instead
+        renderer->setConvergence(false);
+    }
+
+    const sf::Vector2f resolutionF = static_cast<sf::Vector2f>(_options.resolution);
+    Camera camera { resolutionF, {0.001, 0, -4}, {0, 0, 2}, 90, 1.0f };
+
+    std::cout << "Benchmarking " << _options.frames << " frames at "
+              << _options.resolution.x << "x" << _options.resolution.y
+              << " (" << _options.warmupFrames << " warmup, seed " << _options.seed << ")"
+              << (_options.cpu ? " on the CPU renderer" : "") << std::endl;
+
+    sf::Clock clock;
+    const uint32_t totalFrames = _options.warmupFrames + _options.frames;
+    for (uint32_t frame = 0; frame < totalFrames; ++frame)
+    {
+        const bool warmup = frame < _options.warmupFrames;
+        const uint32_t pathFrame = warmup ? 0 : frame - _options.warmupFrames;
+
+        const bool moving = applyCameraPath(camera, pathFrame, _options.frames);
+        const float iTime = static_cast<float>(pathFrame) * benchmarkTimeStep;
+
+        clock.restart();
+        if (cpuRenderer)
+        {
+            cpuRenderer->render(camera);
+        }
+        else
+        {
+            renderer->render(camera, iTime, renderer->isReprojecting() || !moving);
+
+            // Waiting for the GPU so the wall time covers the whole frame
+            renderer->finish();
+        }
+
+        const double milliseconds = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / 1000.0;
+        if (!warmup)
+            _samples.push_back({milliseconds, moving});
+    }
+
+    // Measuring the work saved by the cone pre-pass on the final view
+    if (_options.countSteps && renderer)
+    {
+        const float iTime = static_cast<float>(_options.frames) * benchmarkTimeStep;
+
+        renderer->setConePrepass(true);
+        _stepsWithPrepass = renderer->countSteps(camera, iTime);
+        renderer->setConePrepass(false);
+        _stepsWithoutPrepass = renderer->countSteps(camera, iTime);
+        renderer->setConePrepass(_options.conePrepass);
+    }
+
+    if (_options.compareNormals && renderer)
+        compareNormals(*renderer, camera, static_cast<float>(_options.frames) * benchmarkTimeStep);
+
+    return writeSummary() ? 0 : 1;
+}
+
+void raymarch::Benchmark::compareNormals(Renderer &renderer, const Camera &camera, const float iTime)
+{
+    const FractalParameters original = renderer.getParameters();
+    FractalParameters parameters = original;
+
+    std::vector<float> reference;
+    for (const NormalMode mode : {NormalMode::Central, NormalMode::Tetrahedral, NormalMode::Forward, NormalMode::Analytic})
+    {
+        parameters.normals = mode;
+        renderer.setParameters(parameters);
+
+        // A fresh single-sample pass per frame on the final view, the march itself is the same for every estimator
+        std::vector<double> frameTimes;
+        sf::Clock clock;
+        for (uint32_t frame = 0; frame < _options.warmupFrames + _options.frames; ++frame)
+        {
+            clock.restart();
+            renderer.render(camera, iTime, false);
+            renderer.finish();
+            if (frame >= _options.warmupFrames)
+                frameTimes.push_back(static_cast<double>(clock.getElapsedTime().asMicroseconds()) / 1000.0);
+        }
+
+        // Angle to the central difference normal of every pixel both hit
+        const std::vector<float> normals = renderer.renderNormals(camera);
+        if (mode == NormalMode::Central)
+            reference = normals;
+
+        std::vector<double> errors;
+        for (std::size_t i = 0; i + 3 < normals.size() && i + 3 < reference.size(); i += 4)
+        {
+            if (normals[i + 3] < 0.5f || reference[i + 3] < 0.5f) continue;
+
+            const float cosine = normals[i] * reference[i] + normals[i + 1] * reference[i + 1] + normals[i + 2] * reference[i + 2];
+            errors.push_back(std::acos(std::clamp(cosine, -1.0f, 1.0f)) * 180.0 / PI);
+        }
+
+        _normals.push_back({mode, FrameStatistics::fromSamples(std::move(frameTimes)), FrameStatistics::fromSamples(std::move(errors))});
+    }
+
+    renderer.setParameters(original);
+}
+
+bool raymarch::Benchmark::writeSummary() const
+{
+    std::vector<double> all, moving, accumulating;
+    for (const auto& [milliseconds, isMoving] : _samples)
+    {
+        all.push_back(milliseconds);
+        (isMoving ? moving : accumulating).push_back(milliseconds);
+    }
+
+    const FrameStatistics totalStats = FrameStatistics::fromSamples(all);
+    const FrameStatistics movingStats = FrameStatistics::fromSamples(moving);
+    const FrameStatistics accumulatingStats = FrameStatistics::fromSamples(accumulating);
+
+    printStatistics("total", totalStats);
+    printStatistics("moving", movingStats);
+    printStatistics("accumulating", accumulatingStats);
+
+    if (_stepsWithPrepass && _stepsWithoutPrepass)
+    {
+        const auto perPixel = [](const StepCount& steps) { return static_cast<double>(steps.total()) / static_cast<double>(steps.pixels); };
+        std::cout << "DE calls per pixel: " << perPixel(*_stepsWithoutPrepass) << " without pre-pass, "
+                  << perPixel(*_stepsWithPrepass) << " with pre-pass ("
+                  << perPixel({_stepsWithPrepass->prepass, 0, _stepsWithPrepass->pixels}) << " in the pre-pass)" << std::endl;
+    }
+
+    for (const auto& [mode, frameTimes, error] : _normals)
+    {
+        printStatistics(getNormalModeName(mode), frameTimes);
+        std::cout << std::setw(14) << "" << " error mean " << error.mean << "  p99 " << error.p99 << "  max " << error.max
+                  << " deg over " << error.count << " pixels" << std::endl;
+    }
+
+    std::ofstream file(_options.outputPath);
+    if (!file)
+    {
+        std::cerr << "Failed to write benchmark summary to " << _options.outputPath << std::endl;
+        return false;
+    }
+
+    file << std::setprecision(6);
+    file << "{\n";
+    file << "  \"resolution\": [" << _options.resolution.x << ", " << _options.resolution.y << "],\n";
+    file << "  \"frames\": " << _options.frames << ",\n";
+    file << "  \"warmup_frames\": " << _options.warmupFrames << ",\n";
+    file << "  \"seed\": " << _options.seed << ",\n";
+    file << "  \"fractal\": \"" << getFractalName(_options.fractal) << "\",\n";
+    file << "  \"total\": ";
+    writeStatistics(file, totalStats);
+    file << ",\n  \"moving\": ";
+    writeStatistics(file, movingStats);
+    file << ",\n  \"accumulating\": ";
+    writeStatistics(file, accumulatingStats);
+    if (_stepsWithPrepass && _stepsWithoutPrepass)
+    {
+        file << ",\n  \"de_calls\": {\"pixels\": " << _stepsWithPrepass->pixels
+             << ", \"without_prepass\": " << _stepsWithoutPrepass->total()
+             << ", \"with_prepass\": " << _stepsWithPrepass->total()
+             << ", \"prepass\": " << _stepsWithPrepass->prepass << "}";
+    }
+    if (!_normals.empty())
+    {
+        file << ",\n  \"normals\": [";
+        for (std::size_t i = 0; i < _normals.size(); ++i)
+        {
+            const NormalComparison& comparison = _normals[i];
+            file << (i == 0 ? "\n    " : ",\n    ") << "{\"mode\": \"" << getNormalModeName(comparison.mode) << "\", \"frames\": ";
+            writeStatistics(file, comparison.frameTimes);
+            file << ", \"pixels\": " << comparison.error.count
+                 << ", \"error_mean_deg\": " << comparison.error.mean
+                 << ", \"error_p99_deg\": " << comparison.error.p99
+                 << ", \"error_max_deg\": " << comparison.error.max << "}";
+        }
+        file << "\n  ]";
+    }
+    file << ",\n  \"frame_ms\": [";
+    for (std::size_t i = 0; i < _samples.size(); ++i)
+        file << (i == 0 ? "" : ", ") << _samples[i].milliseconds;
+    file << "]\n}\n";
+
+    std::cout << "Benchmark summary written to " << _options.outputPath << std::endl;
+    return true;
+}
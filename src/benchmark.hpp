@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "options.hpp"
+#include "renderer.hpp"
+
+namespace raymarch
+{
+    struct FrameStatistics
+    {
+        std::size_t count = 0;
+        double mean = 0;
+        double stddev = 0;
+        double min = 0;
+        double p50 = 0;
+        double p90 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+
+        static FrameStatistics fromSamples(std::vector<double> samples);
+    };
+
+    class Benchmark
+    {
+    public:
+        explicit Benchmark(const Options& options);
+        int run();
+    private:
+        struct FrameSample
+        {
+            double milliseconds;
+            bool moving;
+        };
+
+        // Cost of one normal estimator and its angular error against central differences, in degrees
+        struct NormalComparison
+        {
+            NormalMode mode;
+            FrameStatistics frameTimes;
+            FrameStatistics error;
+        };
+
+        const Options& _options;
+        std::vector<FrameSample> _samples;
+        std::vector<NormalComparison> _normals;
+
+        // Distance estimator calls of the final frame
+        std::optional<StepCount> _stepsWithPrepass;
+        std::optional<StepCount> _stepsWithoutPrepass;
+
+        void compareNormals(Renderer &renderer, const Camera &camera, float iTime);
+        [[nodiscard]] bool writeSummary() const;
+    };
+}
@@ -0,0 +1,278 @@
+#include "bookmarks.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+#include "config.hpp"
+#include "debugtext.hpp"
+#include "imagewriter.hpp"
+
+namespace
+{
+    constexpr const char* indexHeader = "FBMK 1";
+
+    // One bookmark per line: slot, camera, fractal parameters and the name, which runs to the end of the line
+    void writeBookmark(std::ostream &out, const std::size_t slot, const raymarch::Bookmark &bookmark)
+    {
+        const raymarch::CameraState &camera = bookmark.camera;
+        const raymarch::FractalParameters &parameters = bookmark.parameters;
+        const std::array<float, 4> q = camera.orientation.toArray();
+
+        // Every digit of the double origin, a deep zoom view is lost with the stream's default six
+        const std::streamsize precision = out.precision();
+        out << slot + 1 << ' ' << std::setprecision(std::numeric_limits<double>::max_digits10)
+            << camera.position.x << ' ' << camera.position.y << ' ' << camera.position.z << ' '
+            << std::setprecision(precision) << q[0] << ' ' << q[1] << ' ' << q[2] << ' ' << q[3] << ' '
+            << camera.fov << ' ' << camera.zoom << ' ' << camera.aperture << ' ' << camera.focusDistance << ' '
+            << raymarch::getFractalName(parameters.fractal) << ' ' << parameters.power << ' ' << parameters.iterations << ' '
+            << parameters.epsilon << ' ' << parameters.maxDistance << ' ' << parameters.boxScale << ' ' << parameters.boxFoldLimit << ' '
+            << raymarch::getNormalModeName(parameters.normals) << ' ' << bookmark.name << '\n';
+    }
+
+    std::optional<std::pair<std::size_t, raymarch::Bookmark>> readBookmark(const std::string &line)
+    {
+        std::istringstream in(line);
+        std::size_t slot = 0;
+        std::array<float, 4> q {};
+        std::string fractal, normals;
+        raymarch::Bookmark bookmark;
+        raymarch::CameraState &camera = bookmark.camera;
+        raymarch::FractalParameters &parameters = bookmark.parameters;
+
+        in >> slot
+           >> camera.position.x >> camera.position.y >> camera.position.z
+           >> q[0] >> q[1] >> q[2] >> q[3]
+           >> camera.fov >> camera.zoom >> camera.aperture >> camera.focusDistance
+           >> fractal >> parameters.power >> parameters.iterations
+           >> parameters.epsilon >> parameters.maxDistance >> parameters.boxScale >> parameters.boxFoldLimit
+           >> normals;
+        if (!in || slot == 0 || slot > raymarch::BookmarkStore::slotCount) return std::nullopt;
+
+        const std::optional<raymarch::FractalType> fractalType = raymarch::parseFractalType(fractal);
+        const std::optional<raymarch::NormalMode> normalMode = raymarch::parseNormalMode(normals);
+        if (!fractalType || !normalMode) return std::nullopt;
+
+        parameters.fractal = *fractalType;
+        parameters.normals = *normalMode;
+        camera.orientation = raymarch::Quaternion(q[0], q[1], q[2], q[3]).normalize();
+        std::getline(in >> std::ws, bookmark.name);
+        return std::make_pair(slot - 1, bookmark);
+    }
+
+    // Same aspect as the window, so the preview frames what the jump will show
+    sf::Vector2u getThumbnailSize()
+    {
+        const float aspect = config::windowSizeF.y / config::windowSizeF.x;
+        return {config::thumbnailWidth, std::max(1u, static_cast<unsigned int>(static_cast<float>(config::thumbnailWidth) * aspect + 0.5f))};
+    }
+}
+
+raymarch::BookmarkStore::BookmarkStore(std::filesystem::path directory) :
+    _directory(std::move(directory))
+{
+}
+
+raymarch::BookmarkStore::~BookmarkStore()
+{
+    if (_writer.joinable())
+        _writer.join();
+}
+
+bool raymarch::BookmarkStore::load()
+{
+    std::ifstream file(getIndexPath());
+    if (!file) return true;
+
+    std::string line;
+    if (!std::getline(file, line) || line != indexHeader)
+    {
+        std::cerr << getIndexPath() << " is not a bookmark index" << std::endl;
+        return false;
+    }
+
+    std::size_t count = 0;
+    while (std::getline(file, line))
+    {
+        if (line.empty()) continue;
+
+        const auto entry = readBookmark(line);
+        if (!entry)
+        {
+            std::cerr << "Skipping malformed bookmark: " << line << std::endl;
+            continue;
+        }
+
+        const auto& [slot, bookmark] = *entry;
+        _slots[slot] = bookmark;
+        ++count;
+
+        // Bookmarks without a cached thumbnail get one rendered again
+        if (!std::filesystem::exists(getThumbnailPath(slot)) || !_thumbnails[slot].loadFromFile(getThumbnailPath(slot)))
+            _pendingThumbnails.push_back(slot);
+    }
+
+    std::cout << "Loaded " << count << " bookmarks from " << getIndexPath() << std::endl;
+    return true;
+}
+
+bool raymarch::BookmarkStore::save() const
+{
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+
+    std::ofstream file(getIndexPath());
+    if (!file)
+    {
+        std::cerr << "Failed to write bookmarks to " << getIndexPath() << std::endl;
+        return false;
+    }
+
+    // Enough digits for every float to read back exactly
+    file << indexHeader << '\n' << std::setprecision(9);
+    for (std::size_t slot = 0; slot < slotCount; ++slot)
+    {
+        if (_slots[slot])
+            writeBookmark(file, slot, *_slots[slot]);
+    }
+    return file.good();
+}
+
+bool raymarch::BookmarkStore::store(const std::size_t slot, const CameraState &camera, const FractalParameters &parameters)
+{
+    if (slot >= slotCount) return false;
+
+    // A slot keeps its name when it is overwritten, names can be edited in the index
+    const std::string name = _slots[slot] ? _slots[slot]->name : "bookmark " + std::to_string(slot + 1);
+    _slots[slot] = Bookmark {name, camera, parameters};
+
+    _pendingThumbnails.erase(std::remove(_pendingThumbnails.begin(), _pendingThumbnails.end(), slot), _pendingThumbnails.end());
+    _pendingThumbnails.push_back(slot);
+
+    if (!save()) return false;
+    std::cout << "Saved " << name << std::endl;
+    return true;
+}
+
+const raymarch::Bookmark* raymarch::BookmarkStore::get(const std::size_t slot) const
+{
+    return slot < slotCount && _slots[slot] ? &*_slots[slot] : nullptr;
+}
+
+void raymarch::BookmarkStore::renderThumbnails(Renderer &renderer, const Camera &camera)
+{
+    if (_pendingThumbnails.empty()) return;
+
+    // The renderer draws its current fractal, a bookmark of another one waits until that is selected
+    const auto pending = std::find_if(_pendingThumbnails.begin(), _pendingThumbnails.end(), [&](const std::size_t slot) {
+        return _slots[slot] && _slots[slot]->parameters == renderer.getParameters();
+    });
+    if (pending == _pendingThumbnails.end()) return;
+
+    const std::size_t slot = *pending;
+    _pendingThumbnails.erase(pending);
+
+    // The interactive camera with the bookmarked view, so deep zoom settings carry over
+    Camera thumbnailCamera = camera;
+    thumbnailCamera.setState(_slots[slot]->camera);
+
+    const sf::Vector2u size = getThumbnailSize();
+    const std::vector<float> texels = renderer.renderRegion(thumbnailCamera, size, {{0, 0}, static_cast<sf::Vector2i>(size)}, config::thumbnailSamples);
+    if (texels.empty()) return;
+
+    // Texel rows are bottom-up, alpha holds the depth
+    std::vector<float> rgb(static_cast<std::size_t>(size.x) * size.y * 3);
+    std::vector<std::uint8_t> rgba(static_cast<std::size_t>(size.x) * size.y * 4, 255);
+    for (unsigned int y = 0; y < size.y; ++y)
+    {
+        const float* source = texels.data() + static_cast<std::size_t>(size.y - 1 - y) * size.x * 4;
+        for (unsigned int x = 0; x < size.x; ++x)
+        {
+            const std::size_t pixel = static_cast<std::size_t>(y) * size.x + x;
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                rgb[pixel * 3 + channel] = source[x * 4 + channel];
+                rgba[pixel * 4 + channel] = static_cast<std::uint8_t>(std::clamp(source[x * 4 + channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    if (!_thumbnails[slot].loadFromImage(sf::Image(size, rgba.data())))
+        std::cerr << "Failed to create the thumbnail texture of bookmark " << slot + 1 << std::endl;
+
+    if (_writer.joinable())
+        _writer.join();
+
+    _writer = std::thread([path = getThumbnailPath(slot), size, rgb = std::move(rgb)]
+    {
+        const std::unique_ptr<ImageStreamWriter> writer = createImageWriter(path, size);
+        if (!writer) return;
+
+        for (unsigned int y = 0; y < size.y; ++y)
+        {
+            if (!writer->writeRow(rgb.data() + static_cast<std::size_t>(y) * size.x * 3)) return;
+        }
+        writer->finish();
+    });
+}
+
+void raymarch::BookmarkStore::toggleOverlay()
+{
+    _overlayVisible = !_overlayVisible;
+}
+
+bool raymarch::BookmarkStore::isOverlayVisible() const
+{
+    return _overlayVisible;
+}
+
+void raymarch::BookmarkStore::drawOverlay(sf::RenderTarget &target) const
+{
+    if (!_overlayVisible) return;
+
+    // A row of previews along the bottom edge, labelled with the key that flies there
+    const sf::Vector2f size = static_cast<sf::Vector2f>(getThumbnailSize());
+    constexpr float margin = 8.0f;
+    constexpr float labelHeight = 14.0f;
+    const float top = static_cast<float>(target.getSize().y) - size.y - margin;
+
+    float left = margin;
+    for (std::size_t slot = 0; slot < slotCount; ++slot)
+    {
+        if (!_slots[slot]) continue;
+
+        sf::RectangleShape frame(size);
+        frame.setPosition({left, top});
+        if (_thumbnails[slot].getSize().x > 0)
+            frame.setTexture(&_thumbnails[slot]);
+        else
+            frame.setFillColor(sf::Color(40, 40, 40));
+        target.draw(frame);
+
+        // The built-in font only has capitals
+        std::string label = std::to_string(slot + 1) + " " + _slots[slot]->name;
+        std::transform(label.begin(), label.end(), label.begin(), [](const unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+        DebugText text;
+        text.setLines({label});
+        text.draw(target, {left, top - labelHeight});
+
+        left += size.x + margin;
+    }
+}
+
+std::filesystem::path raymarch::BookmarkStore::getIndexPath() const
+{
+    return _directory / "bookmarks.txt";
+}
+
+std::filesystem::path raymarch::BookmarkStore::getThumbnailPath(const std::size_t slot) const
+{
+    return _directory / ("bookmark_" + std::to_string(slot + 1) + ".png");
+}
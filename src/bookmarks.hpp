@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "camera.hpp"
+#include "parameters.hpp"
+#include "renderer.hpp"
+
+namespace raymarch
+{
+    // A saved view and the fractal it was found in
+    struct Bookmark
+    {
+        std::string name;
+        CameraState camera;
+        FractalParameters parameters;
+    };
+
+    // Numbered bookmark slots kept in a text index, each with a small preview rendered once when it is saved
+    class BookmarkStore
+    {
+    public:
+        static constexpr std::size_t slotCount = 9;
+
+        explicit BookmarkStore(std::filesystem::path directory);
+        ~BookmarkStore();
+
+        BookmarkStore(const BookmarkStore&) = delete;
+        BookmarkStore& operator=(const BookmarkStore&) = delete;
+
+        // Reads the index and the cached thumbnails, a missing index is an empty store
+        bool load();
+        bool save() const;
+
+        // Replaces the bookmark in a slot, its thumbnail is rendered by the next renderThumbnails()
+        bool store(std::size_t slot, const CameraState &camera, const FractalParameters &parameters);
+        [[nodiscard]] const Bookmark* get(std::size_t slot) const;
+
+        // Renders one pending thumbnail with the interactive renderer, call between frames
+        void renderThumbnails(Renderer &renderer, const Camera &camera);
+
+        void toggleOverlay();
+        [[nodiscard]] bool isOverlayVisible() const;
+        void drawOverlay(sf::RenderTarget &target) const;
+    private:
+        std::filesystem::path _directory;
+        std::array<std::optional<Bookmark>, slotCount> _slots;
+        std::array<sf::Texture, slotCount> _thumbnails;
+        std::vector<std::size_t> _pendingThumbnails;
+        bool _overlayVisible = false;
+
+        // Thumbnails are encoded and written off the render thread
+        std::thread _writer;
+
+        [[nodiscard]] std::filesystem::path getIndexPath() const;
+        [[nodiscard]] std::filesystem::path getThumbnailPath(std::size_t slot) const;
+    };
+}
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <cmath>
 
 #include "camera.hpp"
 
 #include <iostream>
 
+#include "config.hpp"
+
 constexpr float PI = 3.1415927f;
 
 sf::Vector3f lerp(const sf::Vector3f& v1, const sf::Vector3f& v2, const float t)
@@ -18,7 +21,7 @@ float lerp(const float a, const float b, const float t)
 
 raymarch::Camera::Camera(const sf::Vector2f &resolution, const sf::Vector3f &position, const sf::Vector3f &lookAt, const float fov, const float zoom) :
     _resolution(resolution),
-    _position(position),
+    _position(sf::Vector3<double>(position)),
     _quaternion(lookAtQuaternion(position, lookAt, {0, 1, 0})),
     _fov(fov),
     _aspectRatio(resolution.x / resolution.y),
@@ -29,7 +32,12 @@ raymarch::Camera::Camera(const sf::Vector2f &resolution, const sf::Vector3f &pos
 void raymarch::Camera::translate(const sf::Vector3f &delta)
 {
     if (delta.lengthSquared() == 0) return;
-    this->_position += delta;
+    this->_position += sf::Vector3<double>(delta);
+}
+
+void raymarch::Camera::setPosition(const sf::Vector3f &position)
+{
+    this->_position = sf::Vector3<double>(position);
 }
 
 void raymarch::Camera::move(const sf::Vector3f &movementVector, const float deltaTime)
@@ -40,7 +48,8 @@ void raymarch::Camera::move(const sf::Vector3f &movementVector, const float delt
 
     _movementDelta = lerp(_movementDelta, globalMovement, _acceleration);
 
-    _position += _movementDelta * deltaTime;
+    // Deep zoom moves in steps of the visible detail, the sum is kept in double precision
+    _position += sf::Vector3<double>(_movementDelta) * (static_cast<double>(deltaTime) * getDetailScale());
 }
 
 
@@ -62,7 +71,7 @@ sf::Glsl::Mat3 raymarch::Camera::lookAtMatrix(const sf::Vector3f &eye, const sf:
 void raymarch::Camera::lookAt(const sf::Vector3f &target)
 {
     constexpr sf::Vector3f up {0, 1, 0};
-    const sf::Glsl::Mat3 lookAtMatrix = Camera::lookAtMatrix(_position, target, up);
+    const sf::Glsl::Mat3 lookAtMatrix = Camera::lookAtMatrix(sf::Vector3f(_position), target, up);
     _quaternion = Quaternion::fromRotationMatrix(lookAtMatrix).normalize();
     updateDirectionVectors();
 }
@@ -101,7 +110,17 @@ void raymarch::Camera::rotate(const sf::Vector3f& deltaEuler)
 
 sf::Glsl::Vec3 raymarch::Camera::getPosition() const
 {
-    return {this->_position.x, this->_position.y, this->_position.z};
+    return sf::Vector3f(this->_position);
+}
+
+sf::Vector3<double> raymarch::Camera::getOrigin() const
+{
+    return this->_position;
+}
+
+float raymarch::Camera::getDetailScale() const
+{
+    return _deepZoom ? 1.0f / _zoom : 1.0f;
 }
 
 sf::Glsl::Mat3 raymarch::Camera::getRotationMatrix() const
@@ -111,12 +130,15 @@ sf::Glsl::Mat3 raymarch::Camera::getRotationMatrix() const
 
 float raymarch::Camera::getFOV() const
 {
+    // Deep zoom scales the camera down instead, float ray directions cannot resolve a field of view that narrow
+    if (_deepZoom) return _fov * PI / 180.0f;
     return _fov * PI / (180.0f * _zoom);
 }
 
 float raymarch::Camera::getAperture() const
 {
-    return _aperture;
+    // The lens shrinks with the field of view, otherwise deep zoom would blur everything
+    return _aperture * getDetailScale();
 }
 
 float raymarch::Camera::getFocusDistance() const
@@ -134,10 +156,47 @@ bool raymarch::Camera::isMoving() const
         );
 }
 
+bool raymarch::Camera::isDeepZoom() const
+{
+    return _deepZoom;
+}
+
+void raymarch::Camera::setDeepZoom(const bool enabled)
+{
+    _deepZoom = enabled;
+    _zoom = clampZoom(_zoom);
+}
+
+raymarch::CameraState raymarch::Camera::getState() const
+{
+    return {_position, _quaternion, _fov, _zoom, _aperture, _focusDistance};
+}
+
+void raymarch::Camera::setState(const CameraState &state)
+{
+    _position = state.position;
+    _quaternion = state.orientation.normalize();
+    _fov = state.fov;
+    _zoom = clampZoom(state.zoom);
+    _aperture = state.aperture;
+    _focusDistance = state.focusDistance;
+    updateDirectionVectors();
+}
+
 void raymarch::Camera::zoom(const float delta)
 {
     _zoomDelta = lerp(_zoomDelta, delta * _zoomSpeed, _zoomAcceleration);
-    _zoom = std::max(1.f, _zoom + _zoomDelta);
+
+    // Deep zoom is exponential, every wheel step magnifies by the same factor
+    _zoom = clampZoom(_deepZoom ? _zoom * std::exp(_zoomDelta) : _zoom + _zoomDelta);
+}
+
+float raymarch::Camera::clampZoom(const float zoom) const
+{
+    // The reference point of the deep zoom is double precision, the detail it resolves is the limit
+    if (_deepZoom)
+        return std::clamp(zoom, 1.f, config::deepZoomLimit);
+    return std::max(1.f, zoom);
 }
 
 void raymarch::Camera::adjustAperture(const float delta)
@@ -1,10 +1,22 @@
 #pragma once
+#include <chrono>
 #include <SFML/Graphics.hpp>
 
 #include "quaternion.hpp"
 
 namespace raymarch
 {
+    // Everything a keyframe stores, the interactive motion is not part of it
+    struct CameraState
+    {
+        sf::Vector3<double> position;
+        Quaternion orientation = Quaternion::identity();
+        float fov = 90;
+        float zoom = 1;
+        float aperture = 0.01f;
+        float focusDistance = 1;
+    };
+
     class Camera
     {
     public:
@@ -18,22 +30,31 @@ namespace raymarch
         void rotate(const sf::Vector3f &deltaEuler);
         void move(const sf::Vector3f &movementVector, float deltaTime);
         void translate(const sf::Vector3f &delta);
+        void setPosition(const sf::Vector3f &position);
         void zoom(float delta);
         void adjustAperture(float delta);
         void adjustFocus(float delta);
+        void setDeepZoom(bool enabled);
         void lookAt(const sf::Vector3f &target);
         void updateDirectionVectors();
         [[nodiscard]] bool isMoving() const;
+        [[nodiscard]] bool isDeepZoom() const;
+
+        [[nodiscard]] CameraState getState() const;
+        void setState(const CameraState &state);
 
         [[nodiscard]] sf::Glsl::Mat3 getRotationMatrix() const;
         [[nodiscard]] sf::Glsl::Vec3 getPosition() const;
+        [[nodiscard]] sf::Vector3<double> getOrigin() const;
+        [[nodiscard]] float getDetailScale() const;
         [[nodiscard]] float getFOV() const;
         [[nodiscard]] float getAperture() const;
         [[nodiscard]] float getFocusDistance() const;
         [[nodiscard]] static sf::Glsl::Mat3 lookAtMatrix(const sf::Vector3f& eye, const sf::Vector3f& target, const sf::Vector3f& up);
     private:
         sf::Vector2f _resolution;
-        sf::Vector3f _position;
+        // Double precision origin, the shader gets it relative to the reference point of the deep zoom
+        sf::Vector3<double> _position;
         sf::Vector3f _movementDelta = sf::Vector3f(0, 0, 0);
         sf::Vector3f _rotationDelta = sf::Vector3f(0, 0, 0);
         Quaternion _quaternion;
@@ -43,6 +64,7 @@ namespace raymarch
         float _aspectRatio;
         float _zoom;
         float _zoomDelta;
+        bool _deepZoom = false;
 
         float _movementSpeed = 1;
         float _rotationSpeed = 1;
@@ -57,6 +79,17 @@ namespace raymarch
         static constexpr auto FORWARD = sf::Vector3f(0, 0, 1);
         static constexpr auto RIGHT = sf::Vector3f(1, 0, 0);
 
+        [[nodiscard]] float clampZoom(float zoom) const;
         [[nodiscard]] static Quaternion lookAtQuaternion(const sf::Vector3f& eye, const sf::Vector3f& target, const sf::Vector3f& up);
     };
+
+    // The camera as the input thread last published it, moving also covers a flight in progress
+    struct CameraSnapshot
+    {
+        Camera camera;
+        bool moving = false;
+
+        // When the input behind this camera was sampled, the start of its motion-to-photon latency
+        std::chrono::steady_clock::time_point sampleTime;
+    };
 }
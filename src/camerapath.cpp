@@ -0,0 +1,294 @@
+#include "camerapath.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "helpers.hpp"
+
+namespace
+{
+    constexpr char pathMagic[4] = {'F', 'C', 'A', 'M'};
+    constexpr std::uint32_t pathVersion = 2;
+    constexpr std::size_t keyframeFloats = 9;
+
+    // Version 1 kept the position as three floats after the time, deep zoom needs the double origin
+    constexpr std::uint32_t floatPositionVersion = 1;
+
+    // Cubic Hermite segment, the tangents are in units per second so unevenly spaced keys stay smooth
+    template <typename T>
+    T hermite(const T &p1, const T &m1, const T &p2, const T &m2, const float duration, const float u)
+    {
+        const float u2 = u * u;
+        const float u3 = u2 * u;
+        return p1 * (2 * u3 - 3 * u2 + 1) + m1 * (duration * (u3 - 2 * u2 + u)) +
+               p2 * (-2 * u3 + 3 * u2) + m2 * (duration * (u3 - u2));
+    }
+
+    // Catmull-Rom tangent from the neighbouring keys, one-sided at the ends of the path
+    template <typename T, typename Getter>
+    T tangent(const std::vector<raymarch::CameraKeyframe> &keys, const std::size_t i, Getter get)
+    {
+        const std::size_t previous = i > 0 ? i - 1 : i;
+        const std::size_t next = std::min(i + 1, keys.size() - 1);
+        const float span = keys[next].time - keys[previous].time;
+        if (span <= 0) return get(keys[i]) * 0.0f;
+        return (get(keys[next]) - get(keys[previous])) * (1.0f / span);
+    }
+
+    template <typename T, typename Getter>
+    T interpolate(const std::vector<raymarch::CameraKeyframe> &keys, const std::size_t i, const float u, Getter get)
+    {
+        const float duration = keys[i + 1].time - keys[i].time;
+        return hermite(get(keys[i]), tangent<T>(keys, i, get), get(keys[i + 1]), tangent<T>(keys, i + 1, get), duration, u);
+    }
+
+    std::array<float, keyframeFloats> toFloats(const raymarch::CameraKeyframe &key)
+    {
+        const std::array<float, 4> q = key.state.orientation.toArray();
+        const raymarch::CameraState &s = key.state;
+        return {key.time, q[0], q[1], q[2], q[3], s.fov, s.zoom, s.aperture, s.focusDistance};
+    }
+
+    raymarch::CameraKeyframe fromFloats(const std::array<double, 3> &position, const std::array<float, keyframeFloats> &f)
+    {
+        raymarch::CameraKeyframe key;
+        key.time = f[0];
+        key.state.position = {position[0], position[1], position[2]};
+        key.state.orientation = raymarch::Quaternion(f[1], f[2], f[3], f[4]).normalize();
+        key.state.fov = f[5];
+        key.state.zoom = f[6];
+        key.state.aperture = f[7];
+        key.state.focusDistance = f[8];
+        return key;
+    }
+
+    bool readKeyframe(std::istream &file, const std::uint32_t version, raymarch::CameraKeyframe &key)
+    {
+        std::array<double, 3> position {};
+        std::array<float, keyframeFloats> floats {};
+
+        if (version == floatPositionVersion)
+        {
+            std::array<float, 4> timeAndPosition {};
+            file.read(reinterpret_cast<char*>(timeAndPosition.data()), sizeof(timeAndPosition));
+            file.read(reinterpret_cast<char*>(floats.data() + 1), sizeof(float) * (keyframeFloats - 1));
+            floats[0] = timeAndPosition[0];
+            std::copy(timeAndPosition.begin() + 1, timeAndPosition.end(), position.begin());
+        }
+        else
+        {
+            file.read(reinterpret_cast<char*>(position.data()), sizeof(position));
+            file.read(reinterpret_cast<char*>(floats.data()), sizeof(floats));
+        }
+
+        key = fromFloats(position, floats);
+        return static_cast<bool>(file);
+    }
+}
+
+void raymarch::CameraPath::addKeyframe(const float time, const CameraState &state)
+{
+    // Keys stay sorted, a key at the same time replaces the old one
+    const auto it = std::lower_bound(_keyframes.begin(), _keyframes.end(), time,
+                                     [](const CameraKeyframe &key, const float t) { return key.time < t; });
+    if (it != _keyframes.end() && it->time == time)
+        it->state = state;
+    else
+        _keyframes.insert(it, {time, state});
+}
+
+void raymarch::CameraPath::clear()
+{
+    _keyframes.clear();
+}
+
+bool raymarch::CameraPath::isEmpty() const
+{
+    return _keyframes.empty();
+}
+
+std::size_t raymarch::CameraPath::getKeyframeCount() const
+{
+    return _keyframes.size();
+}
+
+float raymarch::CameraPath::getStartTime() const
+{
+    return _keyframes.empty() ? 0.0f : _keyframes.front().time;
+}
+
+float raymarch::CameraPath::getDuration() const
+{
+    return _keyframes.empty() ? 0.0f : _keyframes.back().time - _keyframes.front().time;
+}
+
+raymarch::CameraState raymarch::CameraPath::sample(const float time) const
+{
+    if (_keyframes.empty()) return {};
+    if (time <= _keyframes.front().time) return _keyframes.front().state;
+    if (time >= _keyframes.back().time) return _keyframes.back().state;
+
+    // Segment [i, i + 1] that contains the time
+    const auto next = std::upper_bound(_keyframes.begin(), _keyframes.end(), time,
+                                       [](const float t, const CameraKeyframe &key) { return t < key.time; });
+    const std::size_t i = static_cast<std::size_t>(next - _keyframes.begin()) - 1;
+    const float u = (time - _keyframes[i].time) / (_keyframes[i + 1].time - _keyframes[i].time);
+
+    // Positions are interpolated as float offsets from the segment start, deep zoom paths move far below float precision of the origin
+    const sf::Vector3<double> base = _keyframes[i].state.position;
+    const sf::Vector3f offset = interpolate<sf::Vector3f>(_keyframes, i, u, [&base](const CameraKeyframe &key) { return sf::Vector3f(key.state.position - base); });
+
+    CameraState state;
+    state.position = base + sf::Vector3<double>(offset);
+    state.orientation = Quaternion::slerp(_keyframes[i].state.orientation, _keyframes[i + 1].state.orientation, u);
+    state.fov = interpolate<float>(_keyframes, i, u, [](const CameraKeyframe &key) { return key.state.fov; });
+    state.zoom = std::max(1.0f, interpolate<float>(_keyframes, i, u, [](const CameraKeyframe &key) { return key.state.zoom; }));
+    state.aperture = std::max(0.0f, interpolate<float>(_keyframes, i, u, [](const CameraKeyframe &key) { return key.state.aperture; }));
+    state.focusDistance = std::max(0.1f, interpolate<float>(_keyframes, i, u, [](const CameraKeyframe &key) { return key.state.focusDistance; }));
+    return state;
+}
+
+bool raymarch::CameraPath::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Failed to write camera path to " << path << std::endl;
+        return false;
+    }
+
+    const auto count = static_cast<std::uint32_t>(_keyframes.size());
+    file.write(pathMagic, sizeof(pathMagic));
+    file.write(reinterpret_cast<const char*>(&pathVersion), sizeof(pathVersion));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    for (const CameraKeyframe &key : _keyframes)
+    {
+        const std::array<double, 3> position = {key.state.position.x, key.state.position.y, key.state.position.z};
+        const std::array<float, keyframeFloats> floats = toFloats(key);
+        file.write(reinterpret_cast<const char*>(position.data()), sizeof(position));
+        file.write(reinterpret_cast<const char*>(floats.data()), sizeof(floats));
+    }
+
+    return file.good();
+}
+
+bool raymarch::CameraPath::load(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Failed to open camera path " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t version = 0;
+    std::uint32_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, pathMagic, sizeof(magic)) != 0 || (version != pathVersion && version != floatPositionVersion))
+    {
+        std::cerr << path << " is not a camera path" << std::endl;
+        return false;
+    }
+
+    std::vector<CameraKeyframe> keyframes;
+    keyframes.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        CameraKeyframe key;
+        if (!readKeyframe(file, version, key))
+        {
+            std::cerr << "Camera path " << path << " is truncated" << std::endl;
+            return false;
+        }
+        keyframes.push_back(key);
+    }
+
+    _keyframes.clear();
+    for (const CameraKeyframe &key : keyframes)
+        addKeyframe(key.time, key.state);
+    return true;
+}
+
+raymarch::CameraRecorder::CameraRecorder(const float keyInterval) :
+    _keyInterval(keyInterval)
+{
+}
+
+bool raymarch::CameraRecorder::toggle(const Camera &camera)
+{
+    if (!_recording)
+    {
+        _path.clear();
+        _clock.restart();
+        _nextKey = 0;
+        _recording = true;
+        update(camera);
+        std::cout << "Recording camera path" << std::endl;
+        return true;
+    }
+
+    // The last key holds the camera where the recording stopped
+    _path.addKeyframe(_clock.getElapsedTime().asSeconds(), camera.getState());
+    _recording = false;
+
+    if (const std::string filename = "camera_" + getDateTimeString() + ".campath"; _path.save(filename))
+        std::cout << "Camera path with " << _path.getKeyframeCount() << " keyframes saved to " << filename << std::endl;
+    return false;
+}
+
+bool raymarch::CameraRecorder::isRecording() const
+{
+    return _recording;
+}
+
+void raymarch::CameraRecorder::update(const Camera &camera)
+{
+    if (!_recording) return;
+
+    const float time = _clock.getElapsedTime().asSeconds();
+    if (time < _nextKey) return;
+
+    _path.addKeyframe(time, camera.getState());
+    _nextKey = time + _keyInterval;
+}
+
+void raymarch::CameraFlight::start(const CameraState &from, const CameraState &to, const float duration)
+{
+    // Two keys, the spline between them is a straight line
+    _path.clear();
+    _path.addKeyframe(0, from);
+    _path.addKeyframe(std::max(duration, 1e-3f), to);
+    _clock.restart();
+    _active = true;
+}
+
+void raymarch::CameraFlight::cancel()
+{
+    _active = false;
+}
+
+bool raymarch::CameraFlight::isActive() const
+{
+    return _active;
+}
+
+bool raymarch::CameraFlight::update(Camera &camera)
+{
+    if (!_active) return false;
+
+    // Smoothstep in time, the flight starts and stops without a jolt
+    const float duration = _path.getDuration();
+    const float u = std::min(1.0f, _clock.getElapsedTime().asSeconds() / duration);
+    camera.setState(_path.sample(u * u * (3.0f - 2.0f * u) * duration));
+
+    _active = u < 1.0f;
+    return _active;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <SFML/System/Clock.hpp>
+
+#include "camera.hpp"
+
+namespace raymarch
+{
+    struct CameraKeyframe
+    {
+        float time = 0;
+        CameraState state;
+    };
+
+    // Timed camera keyframes, positions and lens settings follow a spline, orientations are slerped
+    class CameraPath
+    {
+    public:
+        void addKeyframe(float time, const CameraState &state);
+        void clear();
+
+        [[nodiscard]] bool isEmpty() const;
+        [[nodiscard]] std::size_t getKeyframeCount() const;
+        [[nodiscard]] float getStartTime() const;
+        [[nodiscard]] float getDuration() const;
+        [[nodiscard]] CameraState sample(float time) const;
+
+        // Compact little-endian binary, a double position and 9 floats per keyframe, version 1 files with a float position still load
+        bool save(const std::filesystem::path &path) const;
+        bool load(const std::filesystem::path &path);
+    private:
+        std::vector<CameraKeyframe> _keyframes;
+    };
+
+    // Records the interactive camera at a fixed interval and saves the path when stopped
+    class CameraRecorder
+    {
+    public:
+        explicit CameraRecorder(float keyInterval);
+
+        bool toggle(const Camera &camera);
+        [[nodiscard]] bool isRecording() const;
+        void update(const Camera &camera);
+    private:
+        CameraPath _path;
+        sf::Clock _clock;
+        float _keyInterval;
+        float _nextKey = 0;
+        bool _recording = false;
+    };
+
+    // Flies the camera from one view to another, the position eases along a line and the orientation is slerped
+    class CameraFlight
+    {
+    public:
+        void start(const CameraState &from, const CameraState &to, float duration);
+        void cancel();
+        [[nodiscard]] bool isActive() const;
+
+        // Moves the camera along the flight, false once it has arrived
+        bool update(Camera &camera);
+    private:
+        CameraPath _path;
+        sf::Clock _clock;
+        bool _active = false;
+    };
+}
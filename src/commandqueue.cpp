@@ -0,0 +1,25 @@
+#include "commandqueue.hpp"
+
+#include <utility>
+
+void raymarch::CommandQueue::post(std::function<void()> command)
+{
+    const std::lock_guard lock(_mutex);
+    _commands.push_back(std::move(command));
+}
+
+bool raymarch::CommandQueue::run()
+{
+    // Commands may post again, the lock is not held while they run
+    {
+        const std::lock_guard lock(_mutex);
+        _running.swap(_commands);
+    }
+
+    for (const std::function<void()>& command : _running)
+        command();
+
+    const bool ran = !_running.empty();
+    _running.clear();
+    return ran;
+}
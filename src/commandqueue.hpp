@@ -0,0 +1,22 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace raymarch
+{
+    // Work handed from one thread to another and run there in order, for the rare events that cross threads
+    class CommandQueue
+    {
+    public:
+        void post(std::function<void()> command);
+
+        // Runs everything posted so far on the calling thread, false if there was nothing
+        bool run();
+    private:
+        std::mutex _mutex;
+        std::vector<std::function<void()>> _commands;
+        std::vector<std::function<void()>> _running;
+    };
+}
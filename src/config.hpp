@@ -6,4 +6,105 @@ namespace config {
     inline sf::Vector2i windowCenter = sf::Vector2i(windowSize.x / 2, windowSize.y / 2);
     inline constexpr uint32_t maxFrameRate = 144;
     inline constexpr bool isFullscreen = true;
+
+    // Frame pacing instead of the frame rate limit: frames start as late as their predicted cost allows and wait for the GPU on a fence.
+    // Repeats of a converged image are not presented, the last milliseconds before a frame start are spun instead of slept
+    inline constexpr bool framePacing = true;
+    inline constexpr bool skipConvergedPresents = true;
+    inline constexpr float pacerSpinMargin = 1.0f;
+    inline constexpr std::size_t latencySamples = 4096;
+
+    // Input and camera motion are integrated at this fixed rate on the window's thread, the render loop runs on its own
+    inline constexpr uint32_t inputRate = 144;
+
+    // Keeping the accumulated history through camera motion by reprojecting it
+    inline constexpr bool reprojection = true;
+
+    // Weight of the reprojected history while the camera moves, worth blend / (1 - blend) samples
+    inline constexpr float reprojectionBlend = 0.95f;
+
+    // Deep zoom: the camera shrinks by the zoom and the Mandelbox estimator iterates offsets from a double precision reference point.
+    // The reference resolves about 1e-15, the limit leaves the smallest march epsilon (1e-14) above that
+    inline constexpr bool deepZoom = false;
+    inline constexpr float deepZoomLimit = 1e9f;
+
+    // Progressive accumulation keeps the exact mean and stops at this many samples, or once the relative error is below the threshold
+    inline constexpr uint32_t maxSamples = 4096;
+    inline constexpr float convergenceThreshold = 0.002f;
+    inline constexpr uint32_t convergenceFirstCheck = 16;
+
+    // Without float targets the history is RGBA8, past this count the share of a new sample in the mean rounds away
+    inline constexpr uint32_t byteHistoryMaxSamples = 64;
+
+    // Adaptive sampling: tiles of this size whose mean has converged are copied forward instead of marched
+    inline constexpr bool adaptiveSampling = true;
+    inline constexpr uint32_t adaptiveTileSize = 32;
+
+    // Blue noise that rotates the per-pixel sample sequences, generated at startup
+    inline constexpr unsigned int blueNoiseSize = 64;
+    inline constexpr uint32_t blueNoiseSeed = 7;
+
+    // Lowering the render resolution during camera motion to hold maxFrameRate, used when reprojection is off
+    inline constexpr bool adaptiveResolution = true;
+
+    // Progressive tiles: a full resolution pass is spread over as many frames as needed to stay in budget
+    inline constexpr uint32_t tileSize = 128;
+    inline constexpr float frameBudget = 1000.0f / static_cast<float>(maxFrameRate);
+
+    // Cone-marched start distances at 1/8 and 1/4 resolution
+    inline constexpr bool conePrepass = true;
+
+    // Shadow and AO rays sample the estimator baked into a grid of this size over the bounding volume, rebaked per parameter set
+    inline constexpr bool distanceVolume = true;
+    inline constexpr unsigned int distanceVolumeSize = 128;
+
+    // Specialised shader variants for common parameter sets, generated sources are kept in the cache directory
+    inline constexpr bool shaderVariants = true;
+    inline constexpr const char* shaderCacheDirectory = "shader_cache";
+
+    // Camera uniforms in a uniform buffer where GL_ARB_uniform_buffer_object is available
+    inline constexpr bool uniformBuffers = true;
+
+    // Watching the shader directory and swapping in recompiled programs, checked this often in milliseconds
+    inline constexpr bool shaderHotReload = true;
+    inline constexpr uint32_t shaderReloadInterval = 250;
+
+    // Performance overlay: average march steps need a counting frame, so they are sampled only this often
+    inline constexpr float stepSampleInterval = 2.0f;
+
+    // Diagnostic heatmaps: counter values at the hot end of the colour map, histogram bucket size
+    inline constexpr float heatmapStepRange = 256.0f;
+    inline constexpr float heatmapShadowStepRange = 128.0f;
+    inline constexpr float heatmapNormalCallRange = 6.0f;
+    inline constexpr uint32_t heatmapBinWidth = 4;
+
+    // Frame capture: readbacks in flight before the oldest is waited for, sequences use an uncompressed format so encoding keeps up
+    inline constexpr std::size_t captureBuffers = 3;
+
+    // Frames waiting for an encoder, about two seconds at the frame rate limit. A full queue holds the render loop back
+    inline constexpr std::size_t captureQueueFrames = 120;
+    inline constexpr const char* recordingExtension = ".bmp";
+
+    // Offline posters: tiles of this size are accumulated to a fixed sample count and streamed to the file one band at a time
+    inline constexpr uint32_t posterTileSize = 256;
+    inline constexpr uint32_t posterSamples = 64;
+
+    // Camera paths: keyframes are recorded this often in seconds, playback renders at this frame rate by default
+    inline constexpr float cameraKeyInterval = 0.25f;
+    inline constexpr uint32_t animationFrameRate = 30;
+
+    // Bookmarks: index and thumbnails live in this directory, previews are this wide at this sample count, jumps fly for this many seconds
+    inline constexpr const char* bookmarkDirectory = "bookmarks";
+    inline constexpr uint32_t thumbnailWidth = 160;
+    inline constexpr uint32_t thumbnailSamples = 16;
+    inline constexpr float bookmarkFlightDuration = 1.5f;
+
+    // Headless benchmark defaults
+    inline constexpr uint32_t benchmarkFrames = 240;
+    inline constexpr uint32_t benchmarkWarmupFrames = 10;
+    inline constexpr uint32_t benchmarkSeed = 1337;
+
+    // CPU reference renderer, pixels may differ by a few steps of 8-bit colour from the shader
+    inline constexpr uint32_t goldenPixelTolerance = 8;
+    inline constexpr float goldenMaxMismatchRatio = 0.01f;
 }
@@ -0,0 +1,146 @@
+#include "convergence.hpp"
+
+#include <iostream>
+
+#include "glhelpers.hpp"
+
+raymarch::ConvergenceEstimator::~ConvergenceEstimator()
+{
+    if (_fence)
+        gl::deleteFence(_fence);
+    if (_buffer != 0)
+        gl::deleteBuffer(_buffer);
+}
+
+bool raymarch::ConvergenceEstimator::loadShader(const std::filesystem::path &path)
+{
+    _available = gl::supportsFloatTargets() && _shader.loadFromFile(path, sf::Shader::Type::Fragment);
+    if (!_available)
+    {
+        std::cerr << "Failed to load the convergence shader, accumulation runs to the sample limit" << std::endl;
+        return false;
+    }
+
+    _pixelBuffers = gl::loadPixelBuffers();
+    return true;
+}
+
+void raymarch::ConvergenceEstimator::reset(const sf::Vector2u &resolution, const unsigned int tileSize)
+{
+    // A check of the old history that is still in flight no longer applies
+    if (_fence)
+    {
+        gl::deleteFence(_fence);
+        _fence = nullptr;
+    }
+    _result.reset();
+    _hasSnapshot = false;
+    if (!_available || (resolution == _resolution && tileSize == _tileSize)) return;
+
+    _resolution = resolution;
+    _tileSize = tileSize;
+    _grid = {(resolution.x + tileSize - 1) / tileSize, (resolution.y + tileSize - 1) / tileSize};
+
+    if (!_snapshot.resize(resolution) || !gl::makeFloatTarget(_snapshot) ||
+        !_reduction.resize(_grid) || !gl::makeFloatTarget(_reduction))
+    {
+        std::cerr << "Failed to create the convergence targets, accumulation runs to the sample limit" << std::endl;
+        _available = false;
+        return;
+    }
+
+    _quad.setSize(static_cast<sf::Vector2f>(_grid));
+    _shader.setUniform("snapshot", _snapshot.getTexture());
+    _shader.setUniform("resolution", static_cast<sf::Vector2f>(resolution));
+    _shader.setUniform("gridSize", static_cast<sf::Vector2f>(_grid));
+    _shader.setUniform("tileSize", static_cast<float>(tileSize));
+
+    if (_buffer != 0)
+    {
+        gl::deleteBuffer(_buffer);
+        _buffer = 0;
+    }
+}
+
+void raymarch::ConvergenceEstimator::check(const sf::Texture &history)
+{
+    // Targets are sized by the first reset
+    if (!_available || isPending() || _tileSize == 0) return;
+
+    // Change since the snapshot, one texel per tile
+    if (_hasSnapshot)
+    {
+        _shader.setUniform("history", history);
+        sf::RenderStates states(&_shader);
+        states.blendMode = sf::BlendNone;
+        _reduction.clear();
+        _reduction.draw(_quad, states);
+        _reduction.display();
+
+        if (_pixelBuffers && _reduction.setActive(true))
+        {
+            // Queued behind the reduction, the fence tells when it has landed
+            const std::size_t byteCount = static_cast<std::size_t>(_grid.x) * _grid.y * 4 * sizeof(float);
+            if (_buffer == 0)
+                _buffer = gl::createPixelBuffer(byteCount);
+            gl::readFloatPixelsToBuffer(_buffer, _grid);
+            _fence = gl::createFence();
+        }
+        else
+        {
+            const std::vector<float> texels = gl::readFloatTarget(_reduction);
+            if (!texels.empty())
+                _result = toTileChanges(texels.data());
+        }
+    }
+
+    // The next check compares against this history
+    sf::Sprite copy(history);
+    _snapshot.clear();
+    _snapshot.draw(copy, sf::BlendNone);
+    _snapshot.display();
+    _hasSnapshot = true;
+}
+
+std::optional<std::vector<raymarch::TileChange>> raymarch::ConvergenceEstimator::poll()
+{
+    if (_fence && gl::isFenceSignaled(_fence))
+    {
+        gl::deleteFence(_fence);
+        _fence = nullptr;
+
+        // The copy has landed, mapping does not stall any more
+        if (const void* mapped = gl::mapPixelBuffer(_buffer))
+            _result = toTileChanges(static_cast<const float*>(mapped));
+        gl::unmapPixelBuffer();
+    }
+
+    std::optional<std::vector<TileChange>> result = std::move(_result);
+    _result.reset();
+    return result;
+}
+
+bool raymarch::ConvergenceEstimator::isAvailable() const
+{
+    return _available;
+}
+
+bool raymarch::ConvergenceEstimator::isPending() const
+{
+    return _fence != nullptr;
+}
+
+std::vector<raymarch::TileChange> raymarch::ConvergenceEstimator::toTileChanges(const float* texels) const
+{
+    // Texel rows start at the bottom, tiles are numbered from the top
+    std::vector<TileChange> tiles(static_cast<std::size_t>(_grid.x) * _grid.y);
+    for (unsigned int row = 0; row < _grid.y; ++row)
+    {
+        for (unsigned int x = 0; x < _grid.x; ++x)
+        {
+            const float* texel = texels + (static_cast<std::size_t>(row) * _grid.x + x) * 4;
+            tiles[static_cast<std::size_t>(_grid.y - 1 - row) * _grid.x + x] = {texel[0], texel[1], texel[2]};
+        }
+    }
+    return tiles;
+}
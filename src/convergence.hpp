@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Change of the running mean over one adaptive tile between two checks
+    struct TileChange
+    {
+        float squaredError = 0;
+        float luminance = 0;
+        float pixels = 0;
+    };
+
+    // Compares the history with a snapshot from the previous check on the GPU, only one texel per tile is read back and without a stall
+    class ConvergenceEstimator
+    {
+    public:
+        ConvergenceEstimator() = default;
+        ~ConvergenceEstimator();
+
+        ConvergenceEstimator(const ConvergenceEstimator&) = delete;
+        ConvergenceEstimator& operator=(const ConvergenceEstimator&) = delete;
+
+        bool loadShader(const std::filesystem::path &path);
+
+        // Forgets the snapshot and a check in flight, the tiles cover the resolution from the top left
+        void reset(const sf::Vector2u &resolution, unsigned int tileSize);
+
+        // Reduces the change since the last check and snapshots the history, the result arrives through poll()
+        void check(const sf::Texture &history);
+
+        // Tile changes of a finished check in row-major order from the top, empty while the readback is in flight
+        [[nodiscard]] std::optional<std::vector<TileChange>> poll();
+
+        [[nodiscard]] bool isAvailable() const;
+        [[nodiscard]] bool isPending() const;
+    private:
+        sf::Shader _shader;
+        sf::RenderTexture _snapshot;
+        sf::RenderTexture _reduction;
+        sf::RectangleShape _quad;
+        sf::Vector2u _resolution;
+        sf::Vector2u _grid;
+        unsigned int _tileSize = 0;
+        bool _available = false;
+        bool _hasSnapshot = false;
+
+        // Readback of the reduction, read synchronously without pixel buffers
+        bool _pixelBuffers = false;
+        unsigned int _buffer = 0;
+        void* _fence = nullptr;
+        std::optional<std::vector<TileChange>> _result;
+
+        [[nodiscard]] std::vector<TileChange> toTileChanges(const float* texels) const;
+    };
+}
@@ -0,0 +1,505 @@
+#include "cpurenderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+// Lane loops are annotated so that the compiler emits packet code, including vectorised libm calls
+#if defined(RAYMARCH_OPENMP_SIMD) && defined(_MSC_VER)
+#define RAYMARCH_SIMD_LOOP __pragma(omp simd)
+#elif defined(RAYMARCH_OPENMP_SIMD)
+#define RAYMARCH_SIMD_LOOP _Pragma("omp simd")
+#else
+#define RAYMARCH_SIMD_LOOP
+#endif
+
+// The file is compiled for the baseline ISA, kernels get clones for wider vector units that the loader picks on this CPU.
+// Code shared with other files is only ever emitted at the baseline, so no AVX copy of it can be linked in
+#if defined(RAYMARCH_CPU_DISPATCH)
+#define RAYMARCH_PACKET_KERNEL __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#else
+#define RAYMARCH_PACKET_KERNEL
+#endif
+
+namespace
+{
+    // Number of rays evaluated together, one AVX2 vector and the same on every ISA so the images match
+    constexpr int packetWidth = 8;
+
+    constexpr unsigned int tileSize = 32;
+    constexpr int bulbIterations = 10;
+    constexpr int shadowSteps = 128;
+    constexpr float shadowSoftness = 0.05f;
+    constexpr sf::Vector3f lightPosition {100, 100, -10};
+    constexpr sf::Vector3f skyColor {0.529f, 0.808f, 0.922f};
+
+    // Structure-of-arrays packet of vectors, one lane per pixel
+    struct Packet
+    {
+        alignas(64) float x[packetWidth];
+        alignas(64) float y[packetWidth];
+        alignas(64) float z[packetWidth];
+    };
+
+    struct HitPacket
+    {
+        Packet position;
+        Packet normal;
+        float distance[packetWidth];
+        bool hit[packetWidth];
+    };
+
+    // Per-frame camera state, equivalent to the camera uniforms of main.frag
+    struct RayContext
+    {
+        sf::Vector3f origin;
+        float rotation[9];
+        float lens;
+        float aspectRatio;
+        sf::Vector2f resolution;
+        float boundingRadius;
+    };
+
+    // Work-stealing queue: a worker drains its own range of tiles, then steals from the others
+    struct TileQueue
+    {
+        std::atomic<unsigned int> next {0};
+        unsigned int end = 0;
+    };
+
+    // Port of distanceEstimator() in main.frag, escaped lanes are masked instead of breaking
+    RAYMARCH_PACKET_KERNEL
+    void distanceEstimator(const Packet& p, float* distance, const float power)
+    {
+        RAYMARCH_SIMD_LOOP
+        for (int lane = 0; lane < packetWidth; ++lane)
+        {
+            const float cx = p.x[lane];
+            const float cy = p.y[lane];
+            const float cz = p.z[lane];
+
+            float zx = cx, zy = cy, zz = cz;
+            float dr = 1.0f;
+            float r = 0.0f;
+            bool escaped = false;
+
+            for (int i = 0; i < bulbIterations; ++i)
+            {
+                const float length = std::sqrt(zx * zx + zy * zy + zz * zz);
+                r = escaped ? r : length;
+                escaped = escaped || length > 4.0f;
+
+                const float theta = std::acos(zz / length) * power;
+                const float phi = std::atan2(zy, zx) * power;
+                const float sinTheta = std::sin(theta);
+                const float scale = std::pow(length, power);
+
+                const float nextDr = std::pow(length, power - 1.0f) * power * dr + 1.0f;
+                const float nextX = sinTheta * std::cos(phi) * scale + cx;
+                const float nextY = sinTheta * std::sin(phi) * scale + cy;
+                const float nextZ = std::cos(theta) * scale + cz;
+
+                dr = escaped ? dr : nextDr;
+                zx = escaped ? zx : nextX;
+                zy = escaped ? zy : nextY;
+                zz = escaped ? zz : nextZ;
+            }
+
+            distance[lane] = 0.5f * std::log(r) * r / dr;
+        }
+    }
+
+    // Port of computeRayDirection() in main.frag
+    sf::Vector3f computeRayDirection(const RayContext& context, const sf::Vector2f& uv)
+    {
+        const float ndcX = (uv.x * 2.0f - 1.0f) * context.aspectRatio;
+        const float ndcY = uv.y * 2.0f - 1.0f;
+
+        const sf::Vector3f dir = sf::Vector3f(ndcX * context.lens, ndcY * context.lens, 1.0f).normalized();
+
+        // Column-major multiplication, same as camRotationMatrix * dir
+        const float* m = context.rotation;
+        return {
+            m[0] * dir.x + m[3] * dir.y + m[6] * dir.z,
+            m[1] * dir.x + m[4] * dir.y + m[7] * dir.z,
+            m[2] * dir.x + m[5] * dir.y + m[8] * dir.z
+        };
+    }
+
+    // Port of the Mandelbulb's fractalBounds() in estimators.glsl, a sphere around the origin
+    bool fractalBounds(const sf::Vector3f& origin, const sf::Vector3f& dir, const float radius, float& near, float& far)
+    {
+        const float b = origin.dot(dir);
+        const float h = b * b - origin.dot(origin) + radius * radius;
+        if (h < 0.0f) return false;
+
+        near = std::max(-b - std::sqrt(h), 0.0f);
+        far = -b + std::sqrt(h);
+        return far > 0.0f;
+    }
+
+    // Port of raymarch() in main.frag, marching continues until every lane has hit or escaped
+    RAYMARCH_PACKET_KERNEL
+    void raymarch(const sf::Vector3f& origin, const Packet& direction, const float boundingRadius, const raymarch::FractalParameters& parameters, HitPacket& hits)
+    {
+        bool active[packetWidth];
+        float farDistance[packetWidth];
+        bool anyActive = false;
+        for (int lane = 0; lane < packetWidth; ++lane)
+        {
+            hits.position.x[lane] = origin.x;
+            hits.position.y[lane] = origin.y;
+            hits.position.z[lane] = origin.z;
+            hits.distance[lane] = 0.0f;
+            hits.hit[lane] = false;
+
+            // Lanes that miss the bounding sphere are sky, the others start where they enter it
+            float near = 0.0f, far = 0.0f;
+            active[lane] = fractalBounds(origin, {direction.x[lane], direction.y[lane], direction.z[lane]}, boundingRadius, near, far);
+            hits.distance[lane] = near;
+            farDistance[lane] = std::min(far, parameters.maxDistance);
+            anyActive = anyActive || active[lane];
+        }
+
+        Packet p;
+        float d[packetWidth];
+
+        for (int i = 0; i < parameters.iterations && anyActive; ++i)
+        {
+            for (int lane = 0; lane < packetWidth; ++lane)
+            {
+                p.x[lane] = origin.x + direction.x[lane] * hits.distance[lane];
+                p.y[lane] = origin.y + direction.y[lane] * hits.distance[lane];
+                p.z[lane] = origin.z + direction.z[lane] * hits.distance[lane];
+            }
+
+            distanceEstimator(p, d, parameters.power);
+
+            anyActive = false;
+            for (int lane = 0; lane < packetWidth; ++lane)
+            {
+                if (!active[lane]) continue;
+
+                hits.distance[lane] += d[lane];
+
+                if (d[lane] < parameters.epsilon)
+                {
+                    hits.hit[lane] = true;
+                    hits.position.x[lane] = p.x[lane];
+                    hits.position.y[lane] = p.y[lane];
+                    hits.position.z[lane] = p.z[lane];
+                    active[lane] = false;
+                }
+                else if (hits.distance[lane] > farDistance[lane])
+                {
+                    active[lane] = false;
+                }
+
+                anyActive = anyActive || active[lane];
+            }
+
+        }
+    }
+
+    // Port of surfaceNormal() in main.frag, central differences on the whole packet
+    RAYMARCH_PACKET_KERNEL
+    void surfaceNormal(HitPacket& hits, const float h, const float power)
+    {
+        float axisDerivative[3][packetWidth];
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            Packet positive = hits.position;
+            Packet negative = hits.position;
+            float* positiveAxis = axis == 0 ? positive.x : axis == 1 ? positive.y : positive.z;
+            float* negativeAxis = axis == 0 ? negative.x : axis == 1 ? negative.y : negative.z;
+
+            for (int lane = 0; lane < packetWidth; ++lane)
+            {
+                positiveAxis[lane] += h;
+                negativeAxis[lane] -= h;
+            }
+
+            float positiveDistance[packetWidth];
+            float negativeDistance[packetWidth];
+            distanceEstimator(positive, positiveDistance, power);
+            distanceEstimator(negative, negativeDistance, power);
+
+            for (int lane = 0; lane < packetWidth; ++lane)
+                axisDerivative[axis][lane] = positiveDistance[lane] - negativeDistance[lane];
+        }
+
+        for (int lane = 0; lane < packetWidth; ++lane)
+        {
+            const sf::Vector3f gradient {axisDerivative[0][lane], axisDerivative[1][lane], axisDerivative[2][lane]};
+            const sf::Vector3f normal = gradient.lengthSquared() > 0 ? gradient.normalized() : gradient;
+            hits.normal.x[lane] = normal.x;
+            hits.normal.y[lane] = normal.y;
+            hits.normal.z[lane] = normal.z;
+        }
+    }
+
+    // Port of shadowFactor() in main.frag
+    RAYMARCH_PACKET_KERNEL
+    void shadowFactor(const HitPacket& hits, const float epsilon, const float power, const float boundingRadius, float* shadow)
+    {
+        Packet origin, direction, p;
+        float maxDistance[packetWidth], distance[packetWidth], factor[packetWidth];
+        bool active[packetWidth];
+
+        bool anyActive = false;
+        for (int lane = 0; lane < packetWidth; ++lane)
+        {
+            const sf::Vector3f position {hits.position.x[lane], hits.position.y[lane], hits.position.z[lane]};
+            const sf::Vector3f normal {hits.normal.x[lane], hits.normal.y[lane], hits.normal.z[lane]};
+            const sf::Vector3f toLight = lightPosition - position;
+            const sf::Vector3f lightDir = toLight.normalized();
+            const sf::Vector3f shadowOrigin = position + normal * epsilon;
+
+            origin.x[lane] = shadowOrigin.x;
+            origin.y[lane] = shadowOrigin.y;
+            origin.z[lane] = shadowOrigin.z;
+            direction.x[lane] = lightDir.x;
+            direction.y[lane] = lightDir.y;
+            direction.z[lane] = lightDir.z;
+            maxDistance[lane] = toLight.length();
+
+            // Nothing casts a shadow past the exit of the bounding sphere
+            if (float near, far; fractalBounds(shadowOrigin, lightDir, boundingRadius, near, far))
+                maxDistance[lane] = std::min(maxDistance[lane], far);
+            distance[lane] = 0.0f;
+            factor[lane] = 1.0f;
+            active[lane] = hits.hit[lane];
+            anyActive = anyActive || active[lane];
+        }
+
+        float d[packetWidth];
+        for (int i = 0; i < shadowSteps && anyActive; ++i)
+        {
+            for (int lane = 0; lane < packetWidth; ++lane)
+            {
+                p.x[lane] = origin.x[lane] + direction.x[lane] * distance[lane];
+                p.y[lane] = origin.y[lane] + direction.y[lane] * distance[lane];
+                p.z[lane] = origin.z[lane] + direction.z[lane] * distance[lane];
+            }
+
+            distanceEstimator(p, d, power);
+
+            anyActive = false;
+            for (int lane = 0; lane < packetWidth; ++lane)
+            {
+                if (!active[lane]) continue;
+
+                // The shader divides by zero on the first sample, only a negative distance ends the ray there
+                if (distance[lane] > 0.0f)
+                    factor[lane] = std::min(factor[lane], d[lane] / (shadowSoftness * distance[lane]));
+                else if (d[lane] < 0.0f)
+                    factor[lane] = -2.0f;
+
+                distance[lane] += std::clamp(d[lane], 0.005f, 0.50f);
+
+                active[lane] = !(factor[lane] < -1.0f || distance[lane] > maxDistance[lane]);
+                anyActive = anyActive || active[lane];
+            }
+        }
+
+        for (int lane = 0; lane < packetWidth; ++lane)
+        {
+            if (!hits.hit[lane])
+            {
+                shadow[lane] = 1.0f;
+                continue;
+            }
+
+            const float f = std::max(factor[lane], -0.6f);
+            shadow[lane] = 0.25f * (1.0f + f) * (1.0f + f) * (2.0f - f);
+        }
+    }
+
+    std::uint8_t toChannel(const float value)
+    {
+        return static_cast<std::uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    RAYMARCH_PACKET_KERNEL
+    void renderTile(const RayContext& context, const raymarch::FractalParameters& parameters, const sf::Vector2u& resolution,
+                    const unsigned int tileX, const unsigned int tileY, std::uint8_t* pixels)
+    {
+        const unsigned int beginX = tileX * tileSize;
+        const unsigned int beginY = tileY * tileSize;
+        const unsigned int endX = std::min(beginX + tileSize, resolution.x);
+        const unsigned int endY = std::min(beginY + tileSize, resolution.y);
+
+        Packet direction;
+        HitPacket hits;
+        float shadow[packetWidth];
+
+        for (unsigned int row = beginY; row < endY; ++row)
+        {
+            // Image rows go top to bottom, gl_FragCoord goes bottom to top
+            const float fragY = static_cast<float>(resolution.y - row) - 0.5f;
+
+            for (unsigned int x = beginX; x < endX; x += packetWidth)
+            {
+                // Lanes past the tile edge repeat the last pixel and are not written back
+                for (int lane = 0; lane < packetWidth; ++lane)
+                {
+                    const unsigned int column = std::min(x + lane, endX - 1);
+                    const sf::Vector2f uv {(static_cast<float>(column) + 0.5f) / context.resolution.x, fragY / context.resolution.y};
+                    const sf::Vector3f rayDir = computeRayDirection(context, uv);
+                    direction.x[lane] = rayDir.x;
+                    direction.y[lane] = rayDir.y;
+                    direction.z[lane] = rayDir.z;
+                }
+
+                raymarch(context.origin, direction, context.boundingRadius, parameters, hits);
+
+                // Sky-only packets skip the normal and shadow passes
+                if (std::any_of(hits.hit, hits.hit + packetWidth, [](const bool hit) { return hit; }))
+                {
+                    surfaceNormal(hits, parameters.epsilon, parameters.power);
+                    shadowFactor(hits, parameters.epsilon, parameters.power, context.boundingRadius, shadow);
+                }
+                else
+                {
+                    std::fill_n(shadow, packetWidth, 1.0f);
+                }
+
+                for (int lane = 0; lane < packetWidth && x + lane < endX; ++lane)
+                {
+                    const sf::Vector3f normal {hits.normal.x[lane], hits.normal.y[lane], hits.normal.z[lane]};
+                    const sf::Vector3f color = (hits.hit[lane] ? normal : skyColor) * shadow[lane];
+
+                    std::uint8_t* pixel = pixels + (static_cast<std::size_t>(row) * resolution.x + x + lane) * 4;
+                    pixel[0] = toChannel(color.x);
+                    pixel[1] = toChannel(color.y);
+                    pixel[2] = toChannel(color.z);
+                    pixel[3] = 255;
+                }
+            }
+        }
+    }
+}
+
+raymarch::CpuRenderer::CpuRenderer(const sf::Vector2u &resolution, const unsigned int threadCount) :
+    _resolution(resolution),
+    _threadCount(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency())),
+    _pixels(static_cast<std::size_t>(resolution.x) * resolution.y * 4, 0)
+{
+}
+
+void raymarch::CpuRenderer::resize(const sf::Vector2u &resolution)
+{
+    _resolution = resolution;
+    _pixels.assign(static_cast<std::size_t>(resolution.x) * resolution.y * 4, 0);
+    _image.resize(resolution);
+    _textureDirty = true;
+}
+
+void raymarch::CpuRenderer::setParameters(const FractalParameters &parameters)
+{
+    _parameters = parameters;
+}
+
+void raymarch::CpuRenderer::render(const Camera &camera)
+{
+    RayContext context {};
+    context.origin = camera.getPosition();
+    std::copy_n(camera.getRotationMatrix().array, 9, context.rotation);
+    context.lens = std::tan(camera.getFOV() * 0.5f);
+    context.resolution = static_cast<sf::Vector2f>(_resolution);
+    context.aspectRatio = context.resolution.x / context.resolution.y;
+
+    // Only the Mandelbulb is ported, whatever the parameters select
+    FractalParameters mandelbulb = _parameters;
+    mandelbulb.fractal = FractalType::Mandelbulb;
+    context.boundingRadius = getBoundingExtent(mandelbulb);
+
+    const unsigned int tilesX = (_resolution.x + tileSize - 1) / tileSize;
+    const unsigned int tilesY = (_resolution.y + tileSize - 1) / tileSize;
+    const unsigned int tileCount = tilesX * tilesY;
+    if (tileCount == 0) return;
+
+    // Every worker starts with a contiguous block of tiles
+    const unsigned int workerCount = std::min(_threadCount, tileCount);
+    const auto queues = std::make_unique<TileQueue[]>(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        queues[i].next = tileCount * i / workerCount;
+        queues[i].end = tileCount * (i + 1) / workerCount;
+    }
+
+    auto worker = [&](const unsigned int index)
+    {
+        // Own queue first, then steal from the neighbours
+        for (unsigned int offset = 0; offset < workerCount; ++offset)
+        {
+            TileQueue& queue = queues[(index + offset) % workerCount];
+
+            unsigned int tile;
+            while ((tile = queue.next.fetch_add(1, std::memory_order_relaxed)) < queue.end)
+                renderTile(context, _parameters, _resolution, tile % tilesX, tile / tilesX, _pixels.data());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount - 1);
+    for (unsigned int i = 1; i < workerCount; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    _image.resize(_resolution, _pixels.data());
+    _textureDirty = true;
+}
+
+const sf::Image& raymarch::CpuRenderer::getImage() const
+{
+    return _image;
+}
+
+const sf::Texture& raymarch::CpuRenderer::getTexture()
+{
+    // Uploading lazily, golden-image comparisons never need the texture
+    if (_textureDirty)
+    {
+        if (_texture.getSize() != _resolution && !_texture.resize(_resolution))
+            std::cerr << "Failed to resize CPU render texture" << std::endl;
+
+        _texture.update(_image);
+        _textureDirty = false;
+    }
+
+    return _texture;
+}
+
+sf::Vector2u raymarch::CpuRenderer::getResolution() const
+{
+    return _resolution;
+}
+
+unsigned int raymarch::CpuRenderer::getThreadCount() const
+{
+    return _threadCount;
+}
+
+int raymarch::CpuRenderer::getPacketWidth()
+{
+    return packetWidth;
+}
+
+const char* raymarch::CpuRenderer::getInstructionSet()
+{
+    // Same order and features as the kernel clones
+#if defined(RAYMARCH_CPU_DISPATCH)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+        return "AVX-512";
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return "AVX2";
+#endif
+    return "baseline";
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "camera.hpp"
+#include "parameters.hpp"
+
+namespace raymarch
+{
+    // Native port of main.frag, used on machines without a usable GPU and as a golden-image oracle
+    class CpuRenderer
+    {
+    public:
+        explicit CpuRenderer(const sf::Vector2u &resolution, unsigned int threadCount = 0);
+
+        void resize(const sf::Vector2u &resolution);
+        void setParameters(const FractalParameters &parameters);
+        void render(const Camera &camera);
+
+        [[nodiscard]] const sf::Image& getImage() const;
+        [[nodiscard]] const sf::Texture& getTexture();
+        [[nodiscard]] sf::Vector2u getResolution() const;
+        [[nodiscard]] unsigned int getThreadCount() const;
+        [[nodiscard]] static int getPacketWidth();
+
+        // Vector unit the packet kernels run on here, the widest clone this CPU supports
+        [[nodiscard]] static const char* getInstructionSet();
+    private:
+        sf::Vector2u _resolution;
+        FractalParameters _parameters;
+        unsigned int _threadCount;
+
+        std::vector<std::uint8_t> _pixels;
+        sf::Image _image;
+        sf::Texture _texture;
+        bool _textureDirty = true;
+    };
+}
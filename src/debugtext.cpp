@@ -0,0 +1,107 @@
+#include "debugtext.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+namespace
+{
+    constexpr int glyphWidth = 3;
+    constexpr int glyphHeight = 5;
+
+    // Rows from top to bottom, three bits each with the leftmost column in the highest bit
+    constexpr std::uint16_t letters[26] = {
+        0b010'101'111'101'101, 0b110'101'110'101'110, 0b011'100'100'100'011, 0b110'101'101'101'110,
+        0b111'100'110'100'111, 0b111'100'110'100'100, 0b011'100'101'101'011, 0b101'101'111'101'101,
+        0b111'010'010'010'111, 0b001'001'001'101'010, 0b101'101'110'101'101, 0b100'100'100'100'111,
+        0b101'111'111'101'101, 0b110'101'101'101'101, 0b010'101'101'101'010, 0b110'101'110'100'100,
+        0b010'101'101'110'011, 0b110'101'110'101'101, 0b011'100'010'001'110, 0b111'010'010'010'010,
+        0b101'101'101'101'111, 0b101'101'101'101'010, 0b101'101'111'111'101, 0b101'101'010'101'101,
+        0b101'101'010'010'010, 0b111'001'010'100'111
+    };
+
+    constexpr std::uint16_t digits[10] = {
+        0b111'101'101'101'111, 0b010'110'010'010'111, 0b110'001'010'100'111, 0b110'001'010'001'110,
+        0b101'101'111'001'001, 0b111'100'110'001'110, 0b011'100'111'101'111, 0b111'001'010'010'010,
+        0b111'101'111'101'111, 0b111'101'111'001'110
+    };
+
+    std::uint16_t getGlyph(const char character)
+    {
+        const unsigned char c = static_cast<unsigned char>(character);
+        if (std::isalpha(c)) return letters[std::toupper(c) - 'A'];
+        if (std::isdigit(c)) return digits[c - '0'];
+
+        switch (character)
+        {
+            case '.': return 0b000'000'000'000'010;
+            case ':': return 0b000'010'000'010'000;
+            case '-': return 0b000'000'111'000'000;
+            case '/': return 0b001'001'010'100'100;
+            case '%': return 0b101'001'010'100'101;
+            case '(': return 0b001'010'010'010'001;
+            case ')': return 0b100'010'010'010'100;
+            default: return 0;
+        }
+    }
+}
+
+raymarch::DebugText::DebugText(const float pixelSize) :
+    _pixelSize(pixelSize)
+{}
+
+void raymarch::DebugText::setLines(const std::vector<std::string> &lines)
+{
+    _glyphs.clear();
+    _size = {0, 0};
+
+    // One glyph cell plus one pixel of spacing in both directions
+    const float advance = static_cast<float>(glyphWidth + 1) * _pixelSize;
+    const float lineHeight = static_cast<float>(glyphHeight + 2) * _pixelSize;
+
+    for (std::size_t line = 0; line < lines.size(); ++line)
+    {
+        const float y = static_cast<float>(line) * lineHeight;
+
+        for (std::size_t column = 0; column < lines[line].size(); ++column)
+        {
+            const float x = static_cast<float>(column) * advance;
+            const std::uint16_t glyph = getGlyph(lines[line][column]);
+
+            for (int row = 0; row < glyphHeight; ++row)
+                for (int bit = 0; bit < glyphWidth; ++bit)
+                    if (glyph & (1u << ((glyphHeight - 1 - row) * glyphWidth + (glyphWidth - 1 - bit))))
+                        addCell({x + static_cast<float>(bit) * _pixelSize, y + static_cast<float>(row) * _pixelSize});
+        }
+
+        _size.x = std::max(_size.x, static_cast<float>(lines[line].size()) * advance);
+        _size.y = y + lineHeight;
+    }
+}
+
+void raymarch::DebugText::draw(sf::RenderTarget &target, const sf::Vector2f &position) const
+{
+    // Dark backdrop keeps the text readable over bright fractal regions
+    sf::RectangleShape background(_size + sf::Vector2f(2, 2) * _pixelSize);
+    background.setPosition(position - sf::Vector2f(1, 1) * _pixelSize);
+    background.setFillColor(sf::Color(0, 0, 0, 160));
+    target.draw(background);
+
+    sf::RenderStates states;
+    states.transform.translate(position);
+    target.draw(_glyphs, states);
+}
+
+void raymarch::DebugText::addCell(const sf::Vector2f &position)
+{
+    const sf::Vector2f right {_pixelSize, 0};
+    const sf::Vector2f down {0, _pixelSize};
+    const sf::Color color = sf::Color::White;
+
+    _glyphs.append({position, color, {}});
+    _glyphs.append({position + right, color, {}});
+    _glyphs.append({position + down, color, {}});
+    _glyphs.append({position + right, color, {}});
+    _glyphs.append({position + right + down, color, {}});
+    _glyphs.append({position + down, color, {}});
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Tiny built-in 3x5 bitmap font, enough for diagnostics without shipping a font file
+    class DebugText
+    {
+    public:
+        explicit DebugText(float pixelSize = 2.0f);
+
+        void setLines(const std::vector<std::string> &lines);
+        void draw(sf::RenderTarget &target, const sf::Vector2f &position) const;
+    private:
+        float _pixelSize;
+        sf::VertexArray _glyphs {sf::PrimitiveType::Triangles};
+        sf::Vector2f _size;
+
+        void addCell(const sf::Vector2f &position);
+    };
+}
@@ -0,0 +1,121 @@
+#include "distancevolume.hpp"
+
+#include <iostream>
+
+#include "config.hpp"
+#include "glhelpers.hpp"
+
+raymarch::DistanceVolume::DistanceVolume() :
+    _variants(config::shaderCacheDirectory),
+    _quad(sf::Vector2f(static_cast<float>(config::distanceVolumeSize), static_cast<float>(config::distanceVolumeSize)))
+{
+}
+
+raymarch::DistanceVolume::~DistanceVolume()
+{
+    if (_texture != 0)
+        gl::deleteTexture(_texture);
+}
+
+bool raymarch::DistanceVolume::loadShader(const std::filesystem::path &path)
+{
+    _valid = false;
+    _supported = gl::loadVolumeTextures() && gl::supportsFloatTargets();
+    if (!_supported)
+    {
+        std::cerr << "3D float textures are not supported, shadows use the exact estimator" << std::endl;
+        return false;
+    }
+    return _variants.loadSource(path);
+}
+
+bool raymarch::DistanceVolume::bake(const FractalParameters &parameters, const ShaderDefines &defines)
+{
+    _valid = false;
+    if (!_supported) return false;
+
+    // Space repeats without bound for some fractals, a finite grid cannot hold them
+    _extent = getBoundingExtent(parameters);
+    if (_extent >= parameters.maxDistance) return false;
+
+    // The camera block is not declared by the baking shader
+    ShaderDefines estimatorDefines = defines;
+    estimatorDefines.erase("CAMERA_UBO");
+    sf::Shader* shader = _variants.get(estimatorDefines);
+    if (!shader) return false;
+
+    const unsigned int size = config::distanceVolumeSize;
+    if (_slice.getSize() != sf::Vector2u(size, size))
+    {
+        if (!_slice.resize({size, size}) || !gl::makeFloatTarget(_slice))
+        {
+            std::cerr << "Failed to create the distance volume slice target" << std::endl;
+            return false;
+        }
+    }
+
+    if (_texture == 0)
+    {
+        if (!_slice.setActive(true)) return false;
+        _texture = gl::createVolumeTexture(size);
+        _unit = gl::getLastTextureUnit();
+        if (_texture == 0)
+        {
+            std::cerr << "Failed to create the distance volume texture" << std::endl;
+            _supported = false;
+            return false;
+        }
+    }
+
+    // Uniforms of estimators that are not compiled in do not exist in the program
+    if (parameters.fractal == FractalType::Mandelbulb && estimatorDefines.count("POWER_8") == 0)
+        shader->setUniform("power", parameters.power);
+    if (parameters.fractal == FractalType::Mandelbox)
+    {
+        shader->setUniform("boxScale", parameters.boxScale);
+        shader->setUniform("boxFoldLimit", parameters.boxFoldLimit);
+    }
+    shader->setUniform("volumeExtent", _extent);
+    shader->setUniform("volumeSize", static_cast<float>(size));
+
+    // One draw per layer, copied into the 3D texture straight from the framebuffer
+    sf::RenderStates states(shader);
+    states.blendMode = sf::BlendNone;
+    for (unsigned int slice = 0; slice < size; ++slice)
+    {
+        shader->setUniform("volumeSlice", static_cast<float>(slice));
+        _slice.clear();
+        _slice.draw(_quad, states);
+        _slice.display();
+        gl::copyToVolumeSlice(_slice, _texture, slice);
+    }
+
+    _valid = true;
+    return true;
+}
+
+void raymarch::DistanceVolume::bind() const
+{
+    if (_valid)
+        gl::bindVolumeTexture(_texture, _unit);
+}
+
+bool raymarch::DistanceVolume::isValid() const
+{
+    return _valid;
+}
+
+unsigned int raymarch::DistanceVolume::getTextureUnit() const
+{
+    return _unit;
+}
+
+float raymarch::DistanceVolume::getExtent() const
+{
+    return _extent;
+}
+
+float raymarch::DistanceVolume::getTexelSize() const
+{
+    return 2.0f * _extent / static_cast<float>(config::distanceVolumeSize);
+}
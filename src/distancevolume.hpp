@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <SFML/Graphics.hpp>
+
+#include "parameters.hpp"
+#include "shadervariants.hpp"
+
+namespace raymarch
+{
+    // The estimator sampled on a grid over the fractal's bounding cube, a 3D texture for the shadow and AO rays
+    class DistanceVolume
+    {
+    public:
+        DistanceVolume();
+        ~DistanceVolume();
+
+        DistanceVolume(const DistanceVolume&) = delete;
+        DistanceVolume& operator=(const DistanceVolume&) = delete;
+
+        bool loadShader(const std::filesystem::path &path);
+
+        // Bakes the estimator of the variant with these defines on the GPU, false for unbounded fractals or without 3D float textures
+        bool bake(const FractalParameters &parameters, const ShaderDefines &defines);
+        void bind() const;
+
+        [[nodiscard]] bool isValid() const;
+        [[nodiscard]] unsigned int getTextureUnit() const;
+        [[nodiscard]] float getExtent() const;
+        [[nodiscard]] float getTexelSize() const;
+    private:
+        ShaderVariantCache _variants;
+        sf::RenderTexture _slice;
+        sf::RectangleShape _quad;
+        unsigned int _texture = 0;
+        unsigned int _unit = 0;
+        float _extent = 0;
+        bool _supported = false;
+        bool _valid = false;
+    };
+}
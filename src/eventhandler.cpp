@@ -7,15 +7,26 @@
 #include "inputhandler.hpp"
 
 
-raymarch::EventHandler::EventHandler(sf::RenderWindow &window, sf::RectangleShape &fullScreenQuad, sf::Shader &shader, Camera &camera):
+raymarch::EventHandler::EventHandler(sf::RenderWindow &window, Renderer &renderer, Camera &camera, Profiler &profiler, FrameCapture &capture, CameraRecorder &cameraRecorder,
+                                     BookmarkStore &bookmarks, CameraFlight &cameraFlight, CommandQueue &renderCommands, CommandQueue &inputCommands):
 _window(window),
-_fullScreenQuad(fullScreenQuad),
-_shader(shader),
-_camera(camera)
+_renderer(renderer),
+_camera(camera),
+_profiler(profiler),
+_capture(capture),
+_cameraRecorder(cameraRecorder),
+_bookmarks(bookmarks),
+_cameraFlight(cameraFlight),
+_renderCommands(renderCommands),
+_inputCommands(inputCommands),
+_home(camera.getState())
 {}
 
-void raymarch::EventHandler::handleEvents(const float deltaTime) const
+void raymarch::EventHandler::handleEvents(const float deltaTime)
 {
+    // Flights started by the render thread
+    _inputCommands.run();
+
     // Handling camera rotation
     sf::Vector3f movementVector = InputHandler::getNormalizedMovement();
     sf::Vector3f rotationVector = InputHandler::getNormalizedRotation(_window);
@@ -25,50 +36,89 @@ void raymarch::EventHandler::handleEvents(const float deltaTime) const
     _window.handleEvents(
         [&](const sf::Event::Closed&)
         {
-            _window.close();
+            close();
         },
-        [&](const sf::Event::Resized&)
+        [&](const sf::Event::Resized& event)
         {
-            // Getting new size of window and updating config variables
-            config::windowSize = _window.getSize();
-            config::windowSizeF = static_cast<sf::Vector2f>(config::windowSize);
-            config::windowCenter = {static_cast<int>(config::windowSize.x / 2), static_cast<int>(config::windowSize.y / 2)};
-
-            // Updating FSQ size
-            _fullScreenQuad.setSize(config::windowSizeF);
-
-            // Updating viewport size
-            sf::View view = _window.getView();
-            view.setSize(config::windowSizeF);
-            view.setCenter(sf::Vector2f(config::windowSizeF.x / 2.f, config::windowSizeF.y / 2.f));
-            _window.setView(view);
-
-            // Updating shader uniform
-            _shader.setUniform("iResolution", config::windowSizeF);
+            // The size in config and the targets belong to the render thread
+            _renderCommands.post([this, size = event.size]
+            {
+                // Updating config variables
+                config::windowSize = size;
+                config::windowSizeF = static_cast<sf::Vector2f>(config::windowSize);
+                config::windowCenter = {static_cast<int>(config::windowSize.x / 2), static_cast<int>(config::windowSize.y / 2)};
+
+                // Updating viewport size
+                sf::View view = _window.getView();
+                view.setSize(config::windowSizeF);
+                view.setCenter(sf::Vector2f(config::windowSizeF.x / 2.f, config::windowSizeF.y / 2.f));
+                _window.setView(view);
+
+                // Updating FSQ, accumulation buffers and shader uniform
+                _renderer.resize(config::windowSize);
+            });
         },
         [&](const sf::Event::KeyPressed& event)
         {
             switch (event.code)
             {
                 case sf::Keyboard::Key::Escape:
-                    _window.close();
+                    close();
                     break;
-                case sf::Keyboard::Key::F12:
-                {
-                    // Copying window content to a texture
-                    sf::Texture texture {config::windowSize};
-                    texture.update(_window);
-
-                    const sf::Image screenshot = texture.copyToImage();
+                case sf::Keyboard::Key::F3:
+                    _renderCommands.post([this] { _profiler.toggleOverlay(); });
+                    break;
+                case sf::Keyboard::Key::F4:
+                    // Toggling the per-frame CSV trace
+                    _renderCommands.post([this]
+                    {
+                        if (_profiler.isTracing())
+                        {
+                            _profiler.stopTrace();
+                            std::cout << "Trace stopped" << std::endl;
+                        }
+                        else if (const std::string filename = "trace_" + getDateTimeString() + ".csv"; _profiler.startTrace(filename))
+                            std::cout << "Tracing frames to " << filename << std::endl;
+                    });
+                    break;
+                case sf::Keyboard::Key::F5:
+                    // Cycling through the diagnostic heatmaps
+                    _renderCommands.post([this]
+                    {
+                        _renderer.setHeatmap(nextHeatmapChannel(_renderer.getHeatmap()));
+                        std::cout << "Heatmap: " << getHeatmapChannelName(_renderer.getHeatmap()) << std::endl;
+                    });
+                    break;
+                case sf::Keyboard::Key::F6:
+                    // Dumping counter histograms of the current view
+                    _renderCommands.post([this, camera = _camera]
+                    {
+                        if (!_renderer.renderDiagnostics(camera, 0)) return;
 
-                    if (const std::string filename = "screenshot_" + getDateTimeString() + ".png"; screenshot.saveToFile(filename))
-                        std::cout << "Screenshot saved to " << filename << std::endl;
-                    else
-                        std::cerr << "Failed to save screenshot." << std::endl;
+                        const auto histograms = buildHistograms(_renderer.readDiagnostics(), config::heatmapBinWidth);
+                        writeHistograms("heatmap_" + getDateTimeString() + ".json", histograms,
+                                        _renderer.getResolution(), _renderer.getParameters(), config::heatmapBinWidth);
+                    });
+                    break;
+                case sf::Keyboard::Key::F7:
+                    // Starting a camera path, or saving the one being recorded
+                    _cameraRecorder.toggle(_camera);
+                    break;
+                case sf::Keyboard::Key::F8:
+                    // Showing the bookmark thumbnails
+                    _renderCommands.post([this] { _bookmarks.toggleOverlay(); });
+                    break;
+                case sf::Keyboard::Key::F10:
+                    // Toggling continuous capture of every presented frame
+                    _renderCommands.post([this] { _capture.toggleRecording(); });
+                    break;
+                case sf::Keyboard::Key::F12:
+                    // Read back at the end of the next frame and saved on a worker thread
+                    _renderCommands.post([this] { _capture.requestScreenshot(); });
                     break;
-                }
                 case sf::Keyboard::Key::H:
-                    // TODO - Return Home
+                    // Flying back to the view the session started with
+                    _cameraFlight.start(_camera.getState(), _home, config::bookmarkFlightDuration);
                     break;
                 case sf::Keyboard::Key::Down:
                     _camera.adjustFocus(-0.1);
@@ -83,7 +133,13 @@ void raymarch::EventHandler::handleEvents(const float deltaTime) const
                     _camera.adjustAperture(0.01);
                     break;
                 default:
+                {
+                    // 1-9 fly to a bookmark, Ctrl+1-9 save the current view there
+                    const int slot = static_cast<int>(event.code) - static_cast<int>(sf::Keyboard::Key::Num1);
+                    if (slot >= 0 && slot < static_cast<int>(BookmarkStore::slotCount))
+                        handleBookmarkKey(static_cast<std::size_t>(slot), event.control);
                     break;
+                }
             }
         },
         [&](const sf::Event::MouseWheelScrolled& event)
@@ -94,8 +150,49 @@ void raymarch::EventHandler::handleEvents(const float deltaTime) const
             }
         });
 
+    // Moving or zooming takes the camera back from a flight
+    if (_cameraFlight.isActive() && (movementVector.lengthSquared() > 0 || zoomDelta != 0))
+        _cameraFlight.cancel();
+
     _camera.zoom(zoomDelta);
     _camera.move(movementVector, deltaTime);
     _camera.rotate(rotationVector);
+    _cameraFlight.update(_camera);
 }
 
+void raymarch::EventHandler::handleBookmarkKey(const std::size_t slot, const bool save) const
+{
+    if (save)
+    {
+        _renderCommands.post([this, slot, state = _camera.getState()] { _bookmarks.store(slot, state, _renderer.getParameters()); });
+        return;
+    }
+
+    _renderCommands.post([this, slot]
+    {
+        const Bookmark* bookmark = _bookmarks.get(slot);
+        if (!bookmark)
+        {
+            std::cout << "No bookmark in slot " << slot + 1 << std::endl;
+            return;
+        }
+
+        // The bookmarked fractal is selected before the flight, which then runs at full speed
+        if (bookmark->parameters != _renderer.getParameters())
+            _renderer.setParameters(bookmark->parameters);
+
+        std::cout << "Flying to " << bookmark->name << std::endl;
+        _inputCommands.post([this, target = bookmark->camera] { _cameraFlight.start(_camera.getState(), target, config::bookmarkFlightDuration); });
+    });
+}
+
+bool raymarch::EventHandler::isCloseRequested() const
+{
+    return _closeRequested;
+}
+
+void raymarch::EventHandler::close()
+{
+    // The render thread flushes the captures in flight and stops before the window is closed
+    _closeRequested = true;
+}
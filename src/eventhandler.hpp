@@ -1,19 +1,43 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 
+#include "bookmarks.hpp"
 #include "camera.hpp"
+#include "camerapath.hpp"
+#include "commandqueue.hpp"
+#include "framecapture.hpp"
+#include "profiler.hpp"
+#include "renderer.hpp"
 
 namespace raymarch
 {
+    // Runs on the window's thread with the camera, everything owned by the render thread is reached through its command queue
     class EventHandler
     {
     public:
-        EventHandler(sf::RenderWindow& window, sf::RectangleShape& fullScreenQuad, sf::Shader& shader, Camera& camera);
-        void handleEvents(float deltaTime) const;
+        EventHandler(sf::RenderWindow& window, Renderer& renderer, Camera& camera, Profiler& profiler, FrameCapture& capture, CameraRecorder& cameraRecorder,
+                     BookmarkStore& bookmarks, CameraFlight& cameraFlight, CommandQueue& renderCommands, CommandQueue& inputCommands);
+        void handleEvents(float deltaTime);
+        [[nodiscard]] bool isCloseRequested() const;
     private:
         sf::RenderWindow& _window;
-        sf::RectangleShape& _fullScreenQuad;
-        sf::Shader& _shader;
+        Renderer& _renderer;
         Camera& _camera;
+        Profiler& _profiler;
+        FrameCapture& _capture;
+        CameraRecorder& _cameraRecorder;
+        BookmarkStore& _bookmarks;
+        CameraFlight& _cameraFlight;
+
+        // Commands for the render thread, and the ones it sends back
+        CommandQueue& _renderCommands;
+        CommandQueue& _inputCommands;
+
+        // View at startup, H flies back to it
+        const CameraState _home;
+        bool _closeRequested = false;
+
+        void close();
+        void handleBookmarkKey(std::size_t slot, bool save) const;
     };
 }
@@ -0,0 +1,217 @@
+#include "framecapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <SFML/OpenGL.hpp>
+
+#include "config.hpp"
+#include "glhelpers.hpp"
+#include "helpers.hpp"
+
+raymarch::FrameCapture::FrameCapture(unsigned int workerCount) :
+    _readbacks(config::captureBuffers)
+{
+    _pixelBuffers = gl::loadPixelBuffers();
+    if (!_pixelBuffers)
+        std::cerr << "Pixel buffer objects are not supported, captures are read back synchronously" << std::endl;
+
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    for (unsigned int i = 0; i < workerCount; ++i)
+        _workers.emplace_back(&FrameCapture::work, this);
+}
+
+raymarch::FrameCapture::~FrameCapture()
+{
+    // Every queued frame is still written, only readbacks that were never collected are lost
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (std::thread& worker : _workers)
+        worker.join();
+}
+
+void raymarch::FrameCapture::requestScreenshot()
+{
+    _screenshotRequested = true;
+}
+
+bool raymarch::FrameCapture::toggleRecording()
+{
+    _recording = !_recording;
+    if (!_recording)
+    {
+        std::cout << "Recording stopped after " << _recordedFrames << " frames" << std::endl;
+        return false;
+    }
+
+    _recordingDirectory = "capture_" + getDateTimeString();
+    _recordedFrames = 0;
+    _throttled = false;
+
+    std::error_code error;
+    std::filesystem::create_directories(_recordingDirectory, error);
+    if (error)
+    {
+        std::cerr << "Failed to create " << _recordingDirectory << ": " << error.message() << std::endl;
+        _recording = false;
+        return false;
+    }
+
+    std::cout << "Recording frames to " << _recordingDirectory << std::endl;
+    return true;
+}
+
+bool raymarch::FrameCapture::isRecording() const
+{
+    return _recording;
+}
+
+void raymarch::FrameCapture::capture(const sf::RenderWindow &window)
+{
+    // Readbacks of earlier frames that the GPU has finished by now
+    collect(false);
+
+    if (!_screenshotRequested && !_recording) return;
+
+    Job job;
+    job.size = window.getSize();
+    if (_screenshotRequested)
+    {
+        job.path = "screenshot_" + getDateTimeString() + ".png";
+        job.announce = true;
+        _screenshotRequested = false;
+    }
+    else
+    {
+        std::ostringstream name;
+        name << "frame_" << std::setw(6) << std::setfill('0') << _recordedFrames++ << config::recordingExtension;
+        job.path = _recordingDirectory / name.str();
+    }
+
+    const std::size_t byteCount = static_cast<std::size_t>(job.size.x) * job.size.y * 4;
+    if (!_pixelBuffers)
+    {
+        job.pixels.resize(byteCount);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, static_cast<GLsizei>(job.size.x), static_cast<GLsizei>(job.size.y), GL_RGBA, GL_UNSIGNED_BYTE, job.pixels.data());
+        enqueue(std::move(job));
+        return;
+    }
+
+    // Every buffer still in flight, waiting for the oldest is the only way not to drop a frame
+    Readback& readback = _readbacks[_nextReadback];
+    if (readback.fence)
+        collect(true);
+
+    if (readback.capacity < byteCount)
+    {
+        if (readback.buffer != 0)
+            gl::deleteBuffer(readback.buffer);
+        readback.buffer = gl::createPixelBuffer(byteCount);
+        readback.capacity = byteCount;
+    }
+
+    gl::readPixelsToBuffer(readback.buffer, job.size);
+    readback.fence = gl::createFence();
+    readback.job = std::move(job);
+
+    _nextReadback = (_nextReadback + 1) % _readbacks.size();
+}
+
+void raymarch::FrameCapture::flush()
+{
+    if (_pixelBuffers)
+        collect(true);
+}
+
+void raymarch::FrameCapture::collect(const bool wait)
+{
+    // Oldest first, so frames reach the encoders in order
+    for (std::size_t i = 0; i < _readbacks.size(); ++i)
+    {
+        Readback& readback = _readbacks[(_nextReadback + i) % _readbacks.size()];
+        if (!readback.fence) continue;
+
+        if (wait)
+            gl::waitFence(readback.fence);
+        else if (!gl::isFenceSignaled(readback.fence))
+            break;
+
+        gl::deleteFence(readback.fence);
+        readback.fence = nullptr;
+
+        Job job = std::move(readback.job);
+        job.pixels.resize(static_cast<std::size_t>(job.size.x) * job.size.y * 4);
+
+        // The copy has landed, mapping does not stall any more
+        if (const void* mapped = gl::mapPixelBuffer(readback.buffer))
+        {
+            std::memcpy(job.pixels.data(), mapped, job.pixels.size());
+            gl::unmapPixelBuffer();
+            enqueue(std::move(job));
+        }
+        else
+        {
+            gl::unmapPixelBuffer();
+            std::cerr << "Failed to map capture buffer for " << job.path << std::endl;
+        }
+    }
+}
+
+void raymarch::FrameCapture::enqueue(Job job)
+{
+    {
+        // A full queue waits for an encoder instead of growing, the recording slows down but keeps every frame
+        std::unique_lock lock(_mutex);
+        if (_jobs.size() >= config::captureQueueFrames && !_throttled)
+        {
+            std::cerr << "Frame encoding is falling behind, recording at the encoders' rate" << std::endl;
+            _throttled = true;
+        }
+        _queueSpace.wait(lock, [this] { return _jobs.size() < config::captureQueueFrames; });
+        _jobs.push_back(std::move(job));
+    }
+    _condition.notify_one();
+}
+
+void raymarch::FrameCapture::work()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock lock(_mutex);
+            _condition.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+            if (_jobs.empty()) return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        _queueSpace.notify_one();
+
+        // GL rows start at the bottom, the window alpha holds the depth of the history
+        const std::size_t rowSize = static_cast<std::size_t>(job.size.x) * 4;
+        std::vector<std::uint8_t> pixels(job.pixels.size());
+        for (unsigned int y = 0; y < job.size.y; ++y)
+        {
+            std::uint8_t* row = pixels.data() + y * rowSize;
+            std::memcpy(row, job.pixels.data() + (job.size.y - 1 - y) * rowSize, rowSize);
+            for (std::size_t x = 3; x < rowSize; x += 4)
+                row[x] = 255;
+        }
+
+        const sf::Image image(job.size, pixels.data());
+        if (!image.saveToFile(job.path))
+            std::cerr << "Failed to save " << job.path << std::endl;
+        else if (job.announce)
+            std::cout << "Screenshot saved to " << job.path.string() << std::endl;
+    }
+}
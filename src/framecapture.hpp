@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Screenshots and frame sequences: readbacks go through a ring of pixel buffers, encoding runs on a worker pool
+    class FrameCapture
+    {
+    public:
+        explicit FrameCapture(unsigned int workerCount = 0);
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        void requestScreenshot();
+        bool toggleRecording();
+        [[nodiscard]] bool isRecording() const;
+
+        // Queues a readback of the window's back buffer, call after drawing and before display
+        void capture(const sf::RenderWindow& window);
+
+        // Hands every readback in flight to the encoders, needs the window context
+        void flush();
+    private:
+        struct Job
+        {
+            std::vector<std::uint8_t> pixels;
+            sf::Vector2u size;
+            std::filesystem::path path;
+            bool announce = false;
+        };
+
+        // Pixel buffer and fence of one frame in flight, the job gets its pixels once the fence has signalled
+        struct Readback
+        {
+            unsigned int buffer = 0;
+            std::size_t capacity = 0;
+            void* fence = nullptr;
+            Job job;
+        };
+
+        // Ring of pixel buffers, the oldest is collected first
+        bool _pixelBuffers = false;
+        std::vector<Readback> _readbacks;
+        std::size_t _nextReadback = 0;
+
+        bool _screenshotRequested = false;
+        bool _recording = false;
+        std::filesystem::path _recordingDirectory;
+        std::uint32_t _recordedFrames = 0;
+
+        // Encoder pool, written files are announced from here
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::condition_variable _queueSpace;
+        std::deque<Job> _jobs;
+        bool _stopping = false;
+
+        // Set once the encoders fell behind this recording, reported a single time
+        bool _throttled = false;
+
+        void collect(bool wait);
+        void enqueue(Job job);
+        void work();
+    };
+}
@@ -0,0 +1,141 @@
+#include "framepacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <SFML/OpenGL.hpp>
+
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "glhelpers.hpp"
+
+namespace
+{
+    using Milliseconds = std::chrono::duration<float, std::milli>;
+
+    float toMilliseconds(const raymarch::FramePacer::Clock::duration duration)
+    {
+        return std::chrono::duration_cast<Milliseconds>(duration).count();
+    }
+
+    raymarch::FramePacer::Clock::duration fromMilliseconds(const float milliseconds)
+    {
+        return std::chrono::duration_cast<raymarch::FramePacer::Clock::duration>(Milliseconds(milliseconds));
+    }
+}
+
+raymarch::FramePacer::FramePacer(const float targetFrameTime) :
+    _period(targetFrameTime),
+    _fences(gl::loadFences()),
+    _target(Clock::now()),
+    _frameStart(_target)
+{
+    if (!_fences)
+        std::cerr << "GL fences are not supported, frame pacing waits with glFinish" << std::endl;
+}
+
+void raymarch::FramePacer::waitForFrameStart()
+{
+    // The OS sleep overshoots, the last stretch before the start is spent yielding
+    const Clock::time_point start = _target - fromMilliseconds(getPredictedCost());
+    const Clock::time_point sleepEnd = start - fromMilliseconds(config::pacerSpinMargin);
+    if (Clock::now() < sleepEnd)
+        std::this_thread::sleep_until(sleepEnd);
+    while (Clock::now() < start)
+        std::this_thread::yield();
+
+    _frameStart = Clock::now();
+}
+
+bool raymarch::FramePacer::shouldPresent(const bool unchanged)
+{
+    // The first frame of a final image is presented, the repeats of it are not
+    if (unchanged && _lastUnchanged)
+    {
+        ++_skippedFrames;
+        advance();
+        return false;
+    }
+
+    _lastUnchanged = unchanged;
+    return true;
+}
+
+void raymarch::FramePacer::endRender()
+{
+    // Waiting keeps a single frame in flight, no queued frames add to the latency
+    if (_fences)
+    {
+        if (void* fence = gl::createFence())
+        {
+            gl::waitFence(fence);
+            gl::deleteFence(fence);
+        }
+    }
+    else
+    {
+        glFinish();
+    }
+
+    // Mean and mean deviation as exponential averages, the prediction reacts to spikes within a few frames
+    const float cost = toMilliseconds(Clock::now() - _frameStart);
+    if (!_costKnown)
+    {
+        _costMean = cost;
+        _costDeviation = cost * 0.5f;
+        _costKnown = true;
+        return;
+    }
+    _costDeviation += (std::abs(cost - _costMean) - _costDeviation) * 0.25f;
+    _costMean += (cost - _costMean) * 0.125f;
+}
+
+void raymarch::FramePacer::presented(const Clock::time_point sampleTime, const bool moving)
+{
+    ++_presentedFrames;
+
+    // Scan-out is not visible to GL, the frame counts as shown once its present has returned
+    if (moving)
+    {
+        _lastLatency = toMilliseconds(Clock::now() - sampleTime);
+        if (_latencies.size() < config::latencySamples)
+            _latencies.push_back(_lastLatency);
+        else
+            _latencies[_nextLatency] = _lastLatency;
+        _nextLatency = (_nextLatency + 1) % config::latencySamples;
+    }
+
+    advance();
+}
+
+float raymarch::FramePacer::getPredictedCost() const
+{
+    // Two deviations of margin, never more than the whole period
+    return _costKnown ? std::min(_costMean + 2.0f * _costDeviation, _period) : _period;
+}
+
+float raymarch::FramePacer::getLastLatency() const
+{
+    return _lastLatency;
+}
+
+void raymarch::FramePacer::printSummary() const
+{
+    std::cout << "Presented " << _presentedFrames << " frames, skipped " << _skippedFrames << " repeats of a converged image" << std::endl;
+
+    const FrameStatistics latency = FrameStatistics::fromSamples(_latencies);
+    if (latency.count == 0) return;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Motion-to-photon latency over " << latency.count << " moving frames:"
+              << " mean " << latency.mean << "  p50 " << latency.p50 << "  p95 " << latency.p95
+              << "  p99 " << latency.p99 << "  max " << latency.max << " ms" << std::endl;
+}
+
+void raymarch::FramePacer::advance()
+{
+    // A late frame does not make the next ones rush to catch up
+    _target = std::max(_target + fromMilliseconds(_period), Clock::now());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace raymarch
+{
+    // Frame pacing in place of the frame rate limit: frames start as late as their predicted cost allows, so the camera they show is fresh
+    class FramePacer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit FramePacer(float targetFrameTime);
+
+        // Sleeps until the frame has to start to be presented on time, the camera is read after this
+        void waitForFrameStart();
+
+        // False for a frame that would present the same final image again, the pacing goes on without it
+        [[nodiscard]] bool shouldPresent(bool unchanged);
+
+        // After the frame's GL calls and before display(): waits for the GPU on a fence and learns what the frame cost
+        void endRender();
+
+        // After display(), with the time the input behind the frame's camera was sampled
+        void presented(Clock::time_point sampleTime, bool moving);
+
+        [[nodiscard]] float getPredictedCost() const;
+        [[nodiscard]] float getLastLatency() const;
+        void printSummary() const;
+    private:
+        float _period;
+        bool _fences;
+
+        // Planned present of the next frame and the start of the current one
+        Clock::time_point _target;
+        Clock::time_point _frameStart;
+
+        // Running mean and mean deviation of the frame cost in milliseconds
+        float _costMean = 0;
+        float _costDeviation = 0;
+        bool _costKnown = false;
+
+        bool _lastUnchanged = false;
+        std::uint64_t _presentedFrames = 0;
+        std::uint64_t _skippedFrames = 0;
+
+        // Motion-to-photon latencies of the frames that showed a moving camera, the newest ones
+        std::vector<double> _latencies;
+        std::size_t _nextLatency = 0;
+        float _lastLatency = 0;
+
+        void advance();
+    };
+}
@@ -0,0 +1,473 @@
+#include "glhelpers.hpp"
+
+#include <cstddef>
+#include <SFML/OpenGL.hpp>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#endif
+#ifndef GL_DYNAMIC_DRAW
+#define GL_DYNAMIC_DRAW 0x88E8
+#endif
+#ifndef GL_INVALID_INDEX
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_TEXTURE_3D
+#define GL_TEXTURE_3D 0x806F
+#endif
+#ifndef GL_TEXTURE_WRAP_R
+#define GL_TEXTURE_WRAP_R 0x8072
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_R16F
+#define GL_R16F 0x822D
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_MAX_TEXTURE_IMAGE_UNITS
+#define GL_MAX_TEXTURE_IMAGE_UNITS 0x8872
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+namespace
+{
+    using GenQueriesFunction = void (APIENTRY *)(GLsizei, GLuint*);
+    using DeleteQueriesFunction = void (APIENTRY *)(GLsizei, const GLuint*);
+    using BeginQueryFunction = void (APIENTRY *)(GLenum, GLuint);
+    using EndQueryFunction = void (APIENTRY *)(GLenum);
+    using GetQueryObjectivFunction = void (APIENTRY *)(GLuint, GLenum, GLint*);
+    using GetQueryObjectui64vFunction = void (APIENTRY *)(GLuint, GLenum, std::uint64_t*);
+
+    using GetUniformLocationFunction = GLint (APIENTRY *)(GLuint, const char*);
+    using Uniform1fFunction = void (APIENTRY *)(GLint, GLfloat);
+    using Uniform1iFunction = void (APIENTRY *)(GLint, GLint);
+    using Uniform2fFunction = void (APIENTRY *)(GLint, GLfloat, GLfloat);
+    using Uniform3fFunction = void (APIENTRY *)(GLint, GLfloat, GLfloat, GLfloat);
+    using UniformMatrix3fvFunction = void (APIENTRY *)(GLint, GLsizei, GLboolean, const GLfloat*);
+
+    using GenBuffersFunction = void (APIENTRY *)(GLsizei, GLuint*);
+    using DeleteBuffersFunction = void (APIENTRY *)(GLsizei, const GLuint*);
+    using BindBufferFunction = void (APIENTRY *)(GLenum, GLuint);
+    using BufferDataFunction = void (APIENTRY *)(GLenum, std::ptrdiff_t, const void*, GLenum);
+    using BufferSubDataFunction = void (APIENTRY *)(GLenum, std::ptrdiff_t, std::ptrdiff_t, const void*);
+    using BindBufferBaseFunction = void (APIENTRY *)(GLenum, GLuint, GLuint);
+    using GetUniformBlockIndexFunction = GLuint (APIENTRY *)(GLuint, const char*);
+    using UniformBlockBindingFunction = void (APIENTRY *)(GLuint, GLuint, GLuint);
+
+    // GLsync is an opaque pointer
+    using MapBufferFunction = void* (APIENTRY *)(GLenum, GLenum);
+    using UnmapBufferFunction = GLboolean (APIENTRY *)(GLenum);
+    using FenceSyncFunction = void* (APIENTRY *)(GLenum, GLbitfield);
+    using DeleteSyncFunction = void (APIENTRY *)(void*);
+    using ClientWaitSyncFunction = GLenum (APIENTRY *)(void*, GLbitfield, std::uint64_t);
+
+    using TexImage3DFunction = void (APIENTRY *)(GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*);
+    using CopyTexSubImage3DFunction = void (APIENTRY *)(GLenum, GLint, GLint, GLint, GLint, GLint, GLint, GLsizei, GLsizei);
+    using ActiveTextureFunction = void (APIENTRY *)(GLenum);
+
+    GetUniformLocationFunction getLocation = nullptr;
+    Uniform1fFunction uniform1f = nullptr;
+    Uniform1iFunction uniform1i = nullptr;
+    Uniform2fFunction uniform2f = nullptr;
+    Uniform3fFunction uniform3f = nullptr;
+    UniformMatrix3fvFunction uniformMatrix3fv = nullptr;
+
+    GenBuffersFunction genBuffers = nullptr;
+    DeleteBuffersFunction deleteBuffers = nullptr;
+    BindBufferFunction bindBuffer = nullptr;
+    BufferDataFunction bufferData = nullptr;
+    BufferSubDataFunction bufferSubData = nullptr;
+    BindBufferBaseFunction bindBufferBase = nullptr;
+    GetUniformBlockIndexFunction getUniformBlockIndex = nullptr;
+    UniformBlockBindingFunction uniformBlockBinding = nullptr;
+
+    MapBufferFunction mapBuffer = nullptr;
+    UnmapBufferFunction unmapBuffer = nullptr;
+    FenceSyncFunction fenceSync = nullptr;
+    DeleteSyncFunction deleteSync = nullptr;
+    ClientWaitSyncFunction clientWaitSync = nullptr;
+
+    TexImage3DFunction texImage3D = nullptr;
+    CopyTexSubImage3DFunction copyTexSubImage3D = nullptr;
+    ActiveTextureFunction activeTexture = nullptr;
+
+    GenQueriesFunction genQueries = nullptr;
+    DeleteQueriesFunction deleteQueries = nullptr;
+    BeginQueryFunction beginQuery = nullptr;
+    EndQueryFunction endQuery = nullptr;
+    GetQueryObjectivFunction getQueryObjectiv = nullptr;
+    GetQueryObjectui64vFunction getQueryObjectui64v = nullptr;
+
+    template <typename Function>
+    bool loadFunction(Function& function, const char* name)
+    {
+        function = reinterpret_cast<Function>(sf::Context::getFunction(name));
+        return function != nullptr;
+    }
+}
+
+bool raymarch::gl::supportsFloatTargets()
+{
+    return sf::Context::isExtensionAvailable("GL_ARB_texture_float") &&
+           sf::Context::isExtensionAvailable("GL_ARB_framebuffer_object");
+}
+
+bool raymarch::gl::makeFloatTarget(sf::RenderTexture &target)
+{
+    if (!supportsFloatTargets() || !target.setActive(true)) return false;
+
+    // Discarding errors left over from earlier calls
+    while (glGetError() != GL_NO_ERROR) {}
+
+    // The FBO keeps its attachment, only the texel format changes
+    const sf::Vector2u size = target.getSize();
+    sf::Texture::bind(&target.getTexture());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y), 0, GL_RGBA, GL_FLOAT, nullptr);
+    sf::Texture::bind(nullptr);
+
+    const bool success = glGetError() == GL_NO_ERROR;
+    target.clear();
+    return success;
+}
+
+std::vector<float> raymarch::gl::readFloatTarget(sf::RenderTexture &target)
+{
+    const sf::Vector2u size = target.getSize();
+    std::vector<float> texels(static_cast<std::size_t>(size.x) * size.y * 4);
+    if (!target.setActive(true)) return {};
+
+    sf::Texture::bind(&target.getTexture());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, texels.data());
+    sf::Texture::bind(nullptr);
+    return texels;
+}
+
+bool raymarch::gl::loadUniformFunctions()
+{
+    return loadFunction(getLocation, "glGetUniformLocation") &&
+           loadFunction(uniform1f, "glUniform1f") &&
+           loadFunction(uniform1i, "glUniform1i") &&
+           loadFunction(uniform2f, "glUniform2f") &&
+           loadFunction(uniform3f, "glUniform3f") &&
+           loadFunction(uniformMatrix3fv, "glUniformMatrix3fv");
+}
+
+int raymarch::gl::getUniformLocation(const unsigned int program, const char* name)
+{
+    return getLocation(program, name);
+}
+
+void raymarch::gl::uniform(const int location, const float value)
+{
+    uniform1f(location, value);
+}
+
+void raymarch::gl::uniform(const int location, const int value)
+{
+    uniform1i(location, value);
+}
+
+void raymarch::gl::uniform(const int location, const float x, const float y)
+{
+    uniform2f(location, x, y);
+}
+
+void raymarch::gl::uniform(const int location, const float x, const float y, const float z)
+{
+    uniform3f(location, x, y, z);
+}
+
+void raymarch::gl::uniformMatrix3(const int location, const float* values)
+{
+    uniformMatrix3fv(location, 1, GL_FALSE, values);
+}
+
+bool raymarch::gl::supportsUniformBuffers()
+{
+    if (!sf::Context::isExtensionAvailable("GL_ARB_uniform_buffer_object")) return false;
+
+    return loadFunction(genBuffers, "glGenBuffers") &&
+           loadFunction(deleteBuffers, "glDeleteBuffers") &&
+           loadFunction(bindBuffer, "glBindBuffer") &&
+           loadFunction(bufferData, "glBufferData") &&
+           loadFunction(bufferSubData, "glBufferSubData") &&
+           loadFunction(bindBufferBase, "glBindBufferBase") &&
+           loadFunction(getUniformBlockIndex, "glGetUniformBlockIndex") &&
+           loadFunction(uniformBlockBinding, "glUniformBlockBinding");
+}
+
+unsigned int raymarch::gl::createUniformBuffer(const std::size_t size)
+{
+    GLuint buffer = 0;
+    genBuffers(1, &buffer);
+    bindBuffer(GL_UNIFORM_BUFFER, buffer);
+    bufferData(GL_UNIFORM_BUFFER, static_cast<std::ptrdiff_t>(size), nullptr, GL_DYNAMIC_DRAW);
+    bindBuffer(GL_UNIFORM_BUFFER, 0);
+    return buffer;
+}
+
+void raymarch::gl::deleteBuffer(const unsigned int buffer)
+{
+    const GLuint id = buffer;
+    deleteBuffers(1, &id);
+}
+
+void raymarch::gl::updateUniformBuffer(const unsigned int buffer, const void* data, const std::size_t size)
+{
+    bindBuffer(GL_UNIFORM_BUFFER, buffer);
+    bufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<std::ptrdiff_t>(size), data);
+    bindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void raymarch::gl::bindUniformBlock(const unsigned int program, const char* blockName, const unsigned int buffer, const unsigned int bindingPoint)
+{
+    const GLuint blockIndex = getUniformBlockIndex(program, blockName);
+    if (blockIndex == GL_INVALID_INDEX) return;
+
+    uniformBlockBinding(program, blockIndex, bindingPoint);
+    bindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+}
+
+bool raymarch::gl::loadPixelBuffers()
+{
+    if (!sf::Context::isExtensionAvailable("GL_ARB_pixel_buffer_object") || !sf::Context::isExtensionAvailable("GL_ARB_sync"))
+        return false;
+
+    return loadFunction(genBuffers, "glGenBuffers") &&
+           loadFunction(deleteBuffers, "glDeleteBuffers") &&
+           loadFunction(bindBuffer, "glBindBuffer") &&
+           loadFunction(bufferData, "glBufferData") &&
+           loadFunction(mapBuffer, "glMapBuffer") &&
+           loadFunction(unmapBuffer, "glUnmapBuffer") &&
+           loadFunction(fenceSync, "glFenceSync") &&
+           loadFunction(deleteSync, "glDeleteSync") &&
+           loadFunction(clientWaitSync, "glClientWaitSync");
+}
+
+bool raymarch::gl::loadFences()
+{
+    if (!sf::Context::isExtensionAvailable("GL_ARB_sync"))
+        return false;
+
+    return loadFunction(fenceSync, "glFenceSync") &&
+           loadFunction(deleteSync, "glDeleteSync") &&
+           loadFunction(clientWaitSync, "glClientWaitSync");
+}
+
+unsigned int raymarch::gl::createPixelBuffer(const std::size_t size)
+{
+    GLuint buffer = 0;
+    genBuffers(1, &buffer);
+    bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    bufferData(GL_PIXEL_PACK_BUFFER, static_cast<std::ptrdiff_t>(size), nullptr, GL_STREAM_READ);
+    bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return buffer;
+}
+
+void raymarch::gl::readPixelsToBuffer(const unsigned int buffer, const sf::Vector2u &size)
+{
+    // With a pack buffer bound the pointer is an offset and the copy is queued instead of waited for
+    bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void raymarch::gl::readFloatPixelsToBuffer(const unsigned int buffer, const sf::Vector2u &size)
+{
+    bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y), GL_RGBA, GL_FLOAT, nullptr);
+    bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+const void* raymarch::gl::mapPixelBuffer(const unsigned int buffer)
+{
+    bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    return mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+}
+
+void raymarch::gl::unmapPixelBuffer()
+{
+    unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void* raymarch::gl::createFence()
+{
+    return fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void raymarch::gl::deleteFence(void* fence)
+{
+    deleteSync(fence);
+}
+
+bool raymarch::gl::isFenceSignaled(void* fence)
+{
+    // Zero timeout only polls, the flush makes sure the fence is submitted at all
+    const GLenum status = clientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+void raymarch::gl::waitFence(void* fence)
+{
+    while (!isFenceSignaled(fence))
+        clientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+}
+
+bool raymarch::gl::loadVolumeTextures()
+{
+    if (!sf::Context::isExtensionAvailable("GL_ARB_texture_rg") || !sf::Context::isExtensionAvailable("GL_ARB_texture_float"))
+        return false;
+
+    return loadFunction(texImage3D, "glTexImage3D") &&
+           loadFunction(copyTexSubImage3D, "glCopyTexSubImage3D") &&
+           loadFunction(activeTexture, "glActiveTexture");
+}
+
+unsigned int raymarch::gl::createVolumeTexture(const unsigned int size)
+{
+    // Discarding errors left over from earlier calls
+    while (glGetError() != GL_NO_ERROR) {}
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    const auto side = static_cast<GLsizei>(size);
+    texImage3D(GL_TEXTURE_3D, 0, GL_R16F, side, side, side, 0, GL_RED, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    if (glGetError() == GL_NO_ERROR) return texture;
+    glDeleteTextures(1, &texture);
+    return 0;
+}
+
+void raymarch::gl::deleteTexture(const unsigned int texture)
+{
+    const GLuint id = texture;
+    glDeleteTextures(1, &id);
+}
+
+void raymarch::gl::copyToVolumeSlice(sf::RenderTexture &source, const unsigned int texture, const unsigned int slice)
+{
+    if (!source.setActive(true)) return;
+
+    // The red channel of the bound framebuffer becomes one layer
+    const sf::Vector2u size = source.getSize();
+    glBindTexture(GL_TEXTURE_3D, texture);
+    copyTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, static_cast<GLint>(slice), 0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void raymarch::gl::bindVolumeTexture(const unsigned int texture, const unsigned int unit)
+{
+    // SFML binds its own textures from unit 1 up and leaves unit 0 active, the 3D target of another unit is never touched
+    activeTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    activeTexture(GL_TEXTURE0);
+}
+
+unsigned int raymarch::gl::getLastTextureUnit()
+{
+    GLint units = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+    return units > 1 ? static_cast<unsigned int>(units - 1) : 0;
+}
+
+bool raymarch::gl::loadTimerQueries()
+{
+    if (!sf::Context::isExtensionAvailable("GL_ARB_timer_query")) return false;
+
+    return loadFunction(genQueries, "glGenQueries") &&
+           loadFunction(deleteQueries, "glDeleteQueries") &&
+           loadFunction(beginQuery, "glBeginQuery") &&
+           loadFunction(endQuery, "glEndQuery") &&
+           loadFunction(getQueryObjectiv, "glGetQueryObjectiv") &&
+           loadFunction(getQueryObjectui64v, "glGetQueryObjectui64v");
+}
+
+unsigned int raymarch::gl::createQuery()
+{
+    GLuint query = 0;
+    genQueries(1, &query);
+    return query;
+}
+
+void raymarch::gl::deleteQuery(const unsigned int query)
+{
+    const GLuint id = query;
+    deleteQueries(1, &id);
+}
+
+void raymarch::gl::beginTimeElapsed(const unsigned int query)
+{
+    beginQuery(GL_TIME_ELAPSED, query);
+}
+
+void raymarch::gl::endTimeElapsed()
+{
+    endQuery(GL_TIME_ELAPSED);
+}
+
+bool raymarch::gl::isQueryAvailable(const unsigned int query)
+{
+    GLint available = 0;
+    getQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != 0;
+}
+
+std::uint64_t raymarch::gl::getQueryResult(const unsigned int query)
+{
+    std::uint64_t nanoseconds = 0;
+    getQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    return nanoseconds;
+}
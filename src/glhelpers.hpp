@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch::gl
+{
+    [[nodiscard]] bool supportsFloatTargets();
+
+    // SFML only creates RGBA8 render textures, this redefines the storage as RGBA32F in place
+    bool makeFloatTarget(sf::RenderTexture& target);
+
+    // Unclamped RGBA texels of a float target, copyToImage would quantise them to 8 bits
+    [[nodiscard]] std::vector<float> readFloatTarget(sf::RenderTexture& target);
+
+    // Raw glUniform* calls on the bound program, SFML binds and unbinds the program around every setUniform
+    bool loadUniformFunctions();
+    [[nodiscard]] int getUniformLocation(unsigned int program, const char* name);
+    void uniform(int location, float value);
+    void uniform(int location, int value);
+    void uniform(int location, float x, float y);
+    void uniform(int location, float x, float y, float z);
+    void uniformMatrix3(int location, const float* values);
+
+    // Uniform buffer objects (GL 3.1 / ARB_uniform_buffer_object)
+    [[nodiscard]] bool supportsUniformBuffers();
+    [[nodiscard]] unsigned int createUniformBuffer(std::size_t size);
+    void deleteBuffer(unsigned int buffer);
+    void updateUniformBuffer(unsigned int buffer, const void* data, std::size_t size);
+    void bindUniformBlock(unsigned int program, const char* blockName, unsigned int buffer, unsigned int bindingPoint);
+
+    // Pixel pack buffers (GL 2.1 / ARB_pixel_buffer_object) and fences (GL 3.2 / ARB_sync) for readbacks that do not stall
+    bool loadPixelBuffers();
+    [[nodiscard]] unsigned int createPixelBuffer(std::size_t size);
+    void readPixelsToBuffer(unsigned int buffer, const sf::Vector2u& size);
+    void readFloatPixelsToBuffer(unsigned int buffer, const sf::Vector2u& size);
+    [[nodiscard]] const void* mapPixelBuffer(unsigned int buffer);
+    void unmapPixelBuffer();
+    [[nodiscard]] void* createFence();
+    void deleteFence(void* fence);
+    [[nodiscard]] bool isFenceSignaled(void* fence);
+    void waitFence(void* fence);
+
+    // Only the fences, for waiting on the GPU without glFinish
+    bool loadFences();
+
+    // Single channel half float 3D textures (GL 1.2 3D textures, ARB_texture_rg), filled slice by slice from a render target
+    bool loadVolumeTextures();
+    [[nodiscard]] unsigned int createVolumeTexture(unsigned int size);
+    void deleteTexture(unsigned int texture);
+    void copyToVolumeSlice(sf::RenderTexture& source, unsigned int texture, unsigned int slice);
+    void bindVolumeTexture(unsigned int texture, unsigned int unit);
+    [[nodiscard]] unsigned int getLastTextureUnit();
+
+    // GL_TIME_ELAPSED queries (GL 3.3 / ARB_timer_query), loaded through the active context
+    bool loadTimerQueries();
+    [[nodiscard]] unsigned int createQuery();
+    void deleteQuery(unsigned int query);
+    void beginTimeElapsed(unsigned int query);
+    void endTimeElapsed();
+    [[nodiscard]] bool isQueryAvailable(unsigned int query);
+    [[nodiscard]] std::uint64_t getQueryResult(unsigned int query);
+}
@@ -0,0 +1,99 @@
+#include "golden.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "config.hpp"
+#include "cpurenderer.hpp"
+#include "renderer.hpp"
+
+raymarch::ImageDifference raymarch::compareImages(const sf::Image &expected, const sf::Image &actual, const int pixelTolerance)
+{
+    ImageDifference difference;
+    if (expected.getSize() != actual.getSize())
+    {
+        difference.maxError = 255;
+        difference.mismatchRatio = 1.0;
+        return difference;
+    }
+
+    const std::size_t pixelCount = static_cast<std::size_t>(expected.getSize().x) * expected.getSize().y;
+    const std::uint8_t* a = expected.getPixelsPtr();
+    const std::uint8_t* b = actual.getPixelsPtr();
+
+    std::size_t mismatches = 0;
+    double totalError = 0;
+    for (std::size_t i = 0; i < pixelCount; ++i)
+    {
+        // Alpha is always opaque, only RGB is compared
+        int pixelError = 0;
+        for (std::size_t channel = 0; channel < 3; ++channel)
+        {
+            const int error = std::abs(static_cast<int>(a[i * 4 + channel]) - static_cast<int>(b[i * 4 + channel]));
+            pixelError = std::max(pixelError, error);
+            totalError += error;
+        }
+
+        difference.maxError = std::max(difference.maxError, pixelError);
+        if (pixelError > pixelTolerance) ++mismatches;
+    }
+
+    if (pixelCount > 0)
+    {
+        difference.meanError = totalError / static_cast<double>(pixelCount * 3);
+        difference.mismatchRatio = static_cast<double>(mismatches) / static_cast<double>(pixelCount);
+    }
+
+    return difference;
+}
+
+raymarch::GoldenTest::GoldenTest(const Options &options) :
+    _options(options)
+{
+}
+
+int raymarch::GoldenTest::run() const
+{
+    const sf::Vector2f resolutionF = static_cast<sf::Vector2f>(_options.resolution);
+    const Camera camera { resolutionF, {0.001, 0, -4}, {0, 0, 2}, 90, 1.0f };
+
+    // Shader reference, no accumulation so jitter and depth of field are off, and shadows of the exact estimator like the port
+    Renderer renderer {_options.resolution};
+    renderer.setDistanceVolume(false);
+    if (!renderer.loadShader("shaders/main.frag")) return 1;
+    renderer.render(camera, 0.0f, false);
+    sf::Image gpuImage = renderer.getTexture().copyToImage();
+
+    // Alpha carries the depth, the saved image should be opaque
+    for (unsigned int y = 0; y < gpuImage.getSize().y; ++y)
+        for (unsigned int x = 0; x < gpuImage.getSize().x; ++x)
+        {
+            sf::Color color = gpuImage.getPixel({x, y});
+            color.a = 255;
+            gpuImage.setPixel({x, y}, color);
+        }
+
+    CpuRenderer cpuRenderer {_options.resolution, _options.threads};
+    cpuRenderer.setParameters(renderer.getParameters());
+
+    sf::Clock clock;
+    cpuRenderer.render(camera);
+    const float cpuSeconds = clock.getElapsedTime().asSeconds();
+
+    std::cout << "CPU render took " << cpuSeconds << " s on " << cpuRenderer.getThreadCount()
+              << " threads with " << CpuRenderer::getPacketWidth() << "-wide " << CpuRenderer::getInstructionSet() << " packets" << std::endl;
+
+    if (!gpuImage.saveToFile("golden_gpu.png") || !cpuRenderer.getImage().saveToFile("golden_cpu.png"))
+        std::cerr << "Failed to save golden images" << std::endl;
+
+    const ImageDifference difference = compareImages(gpuImage, cpuRenderer.getImage(), config::goldenPixelTolerance);
+    const bool passed = difference.mismatchRatio <= config::goldenMaxMismatchRatio;
+
+    std::cout << "Mean error " << difference.meanError
+              << ", max error " << difference.maxError
+              << ", " << difference.mismatchRatio * 100.0 << "% of pixels above tolerance "
+              << config::goldenPixelTolerance << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "options.hpp"
+
+namespace raymarch
+{
+    struct ImageDifference
+    {
+        double meanError = 0;
+        int maxError = 0;
+        double mismatchRatio = 0;
+    };
+
+    ImageDifference compareImages(const sf::Image& expected, const sf::Image& actual, int pixelTolerance);
+
+    // Renders the same view with the shader and the CPU renderer and checks that they agree
+    class GoldenTest
+    {
+    public:
+        explicit GoldenTest(const Options& options);
+        int run() const;
+    private:
+        const Options& _options;
+    };
+}
@@ -0,0 +1,111 @@
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "config.hpp"
+
+raymarch::HeatmapChannel raymarch::nextHeatmapChannel(const HeatmapChannel channel)
+{
+    switch (channel)
+    {
+        case HeatmapChannel::None: return HeatmapChannel::Steps;
+        case HeatmapChannel::Steps: return HeatmapChannel::ShadowSteps;
+        case HeatmapChannel::ShadowSteps: return HeatmapChannel::NormalCalls;
+        case HeatmapChannel::NormalCalls: return HeatmapChannel::DeCalls;
+        default: return HeatmapChannel::None;
+    }
+}
+
+const char* raymarch::getHeatmapChannelName(const HeatmapChannel channel)
+{
+    switch (channel)
+    {
+        case HeatmapChannel::Steps: return "steps";
+        case HeatmapChannel::ShadowSteps: return "shadow_steps";
+        case HeatmapChannel::NormalCalls: return "normal_de_calls";
+        case HeatmapChannel::DeCalls: return "de_calls";
+        default: return "none";
+    }
+}
+
+float raymarch::getHeatmapRange(const HeatmapChannel channel)
+{
+    switch (channel)
+    {
+        case HeatmapChannel::Steps: return config::heatmapStepRange;
+        case HeatmapChannel::ShadowSteps: return config::heatmapShadowStepRange;
+        case HeatmapChannel::NormalCalls: return config::heatmapNormalCallRange;
+        default: return config::heatmapStepRange + config::heatmapShadowStepRange + config::heatmapNormalCallRange;
+    }
+}
+
+std::array<raymarch::CounterHistogram, raymarch::heatmapChannelCount> raymarch::buildHistograms(const std::vector<float> &counters, const unsigned int binWidth)
+{
+    std::array<CounterHistogram, heatmapChannelCount> histograms;
+    const std::size_t pixelCount = counters.size() / heatmapChannelCount;
+    if (pixelCount == 0) return histograms;
+
+    for (std::size_t channel = 0; channel < heatmapChannelCount; ++channel)
+    {
+        CounterHistogram& histogram = histograms[channel];
+
+        for (std::size_t i = 0; i < pixelCount; ++i)
+        {
+            // Counters are whole numbers, the float target only stores them
+            const auto value = static_cast<std::uint64_t>(std::max(0.0f, std::round(counters[i * heatmapChannelCount + channel])));
+            const std::size_t bin = value / binWidth;
+
+            if (bin >= histogram.bins.size())
+                histogram.bins.resize(bin + 1, 0);
+            ++histogram.bins[bin];
+
+            histogram.total += value;
+            histogram.maximum = std::max(histogram.maximum, static_cast<float>(value));
+        }
+
+        histogram.mean = static_cast<float>(static_cast<double>(histogram.total) / static_cast<double>(pixelCount));
+    }
+
+    return histograms;
+}
+
+bool raymarch::writeHistograms(const std::filesystem::path &path, const std::array<CounterHistogram, heatmapChannelCount> &histograms,
+                               const sf::Vector2u &resolution, const FractalParameters &parameters, const unsigned int binWidth)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Failed to write heatmap histograms to " << path << std::endl;
+        return false;
+    }
+
+    file << "{\n";
+    file << "  \"resolution\": [" << resolution.x << ", " << resolution.y << "],\n";
+    file << "  \"parameters\": {\"fractal\": \"" << getFractalName(parameters.fractal) << "\""
+         << ", \"power\": " << parameters.power
+         << ", \"iterations\": " << parameters.iterations
+         << ", \"epsilon\": " << parameters.epsilon
+         << ", \"max_distance\": " << parameters.maxDistance << "},\n";
+    file << "  \"bin_width\": " << binWidth;
+
+    for (std::size_t channel = 0; channel < heatmapChannelCount; ++channel)
+    {
+        const CounterHistogram& histogram = histograms[channel];
+
+        file << ",\n  \"" << getHeatmapChannelName(static_cast<HeatmapChannel>(channel)) << "\": {"
+             << "\"total\": " << histogram.total
+             << ", \"mean\": " << histogram.mean
+             << ", \"max\": " << histogram.maximum
+             << ", \"histogram\": [";
+        for (std::size_t bin = 0; bin < histogram.bins.size(); ++bin)
+            file << (bin == 0 ? "" : ", ") << histogram.bins[bin];
+        file << "]}";
+    }
+    file << "\n}\n";
+
+    std::cout << "Heatmap histograms written to " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "parameters.hpp"
+
+namespace raymarch
+{
+    // Per-pixel counters of the diagnostic pass, in the order of the float target's channels
+    enum class HeatmapChannel
+    {
+        None = -1,
+        Steps,
+        ShadowSteps,
+        NormalCalls,
+        DeCalls
+    };
+
+    inline constexpr std::size_t heatmapChannelCount = 4;
+
+    [[nodiscard]] HeatmapChannel nextHeatmapChannel(HeatmapChannel channel);
+    [[nodiscard]] const char* getHeatmapChannelName(HeatmapChannel channel);
+    // Counter value shown at the hot end of the colour map
+    [[nodiscard]] float getHeatmapRange(HeatmapChannel channel);
+
+    struct CounterHistogram
+    {
+        std::uint64_t total = 0;
+        float mean = 0;
+        float maximum = 0;
+        std::vector<std::uint64_t> bins;
+    };
+
+    // Histograms of every counter channel over interleaved RGBA floats
+    [[nodiscard]] std::array<CounterHistogram, heatmapChannelCount> buildHistograms(const std::vector<float> &counters, unsigned int binWidth);
+
+    bool writeHistograms(const std::filesystem::path &path, const std::array<CounterHistogram, heatmapChannelCount> &histograms,
+                         const sf::Vector2u &resolution, const FractalParameters &parameters, unsigned int binWidth);
+}
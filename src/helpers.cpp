@@ -4,14 +4,17 @@
 
 #include "config.hpp"
 #include "SFML/Graphics/View.hpp"
-void updateShader(sf::Shader &shader, const raymarch::Camera &camera, const float iTime)
+void updateShader(raymarch::UniformCache &uniforms, const raymarch::Camera &camera, const sf::Vector3<double> &referencePoint, const float iTime)
 {
-    shader.setUniform("camPosition", camera.getPosition());
-    shader.setUniform("camRotationMatrix", camera.getRotationMatrix());
-    shader.setUniform("fov", camera.getFOV());
-    shader.setUniform("aperture", camera.getAperture());
-    shader.setUniform("focusDistance", camera.getFocusDistance());
-    shader.setUniform("iTime", iTime);
+    // The shader works relative to the reference point, the difference is taken before rounding to float
+    uniforms.set("camPosition", sf::Vector3f(camera.getOrigin() - referencePoint));
+    uniforms.set("referencePoint", sf::Vector3f(referencePoint));
+    uniforms.set("detailScale", camera.getDetailScale());
+    uniforms.set("camRotationMatrix", camera.getRotationMatrix());
+    uniforms.set("fov", camera.getFOV());
+    uniforms.set("aperture", camera.getAperture());
+    uniforms.set("focusDistance", camera.getFocusDistance());
+    uniforms.set("iTime", iTime);
 }
 
 std::string getDateTimeString()
@@ -5,7 +5,8 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 
 #include "camera.hpp"
+#include "uniformcache.hpp"
 
 
-void updateShader(sf::Shader& shader, const raymarch::Camera& camera, float iTime);
+void updateShader(raymarch::UniformCache& uniforms, const raymarch::Camera& camera, const sf::Vector3<double>& referencePoint, float iTime);
 std::string getDateTimeString();
\ No newline at end of file
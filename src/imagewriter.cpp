@@ -0,0 +1,343 @@
+#include "imagewriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t maxStoredBlock = 65535;
+
+    std::uint32_t crc32(const std::uint8_t* data, const std::size_t size, std::uint32_t crc = 0)
+    {
+        static const std::array<std::uint32_t, 256> table = []
+        {
+            std::array<std::uint32_t, 256> entries {};
+            for (std::uint32_t n = 0; n < 256; ++n)
+            {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+            return entries;
+        }();
+
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    std::uint32_t adler32(const std::uint8_t* data, const std::size_t size, const std::uint32_t adler)
+    {
+        std::uint32_t a = adler & 0xFFFF;
+        std::uint32_t b = adler >> 16;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void appendBigEndian(std::vector<std::uint8_t> &bytes, const std::uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            bytes.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+
+    // EXR is little-endian throughout
+    template <typename T>
+    void appendLittleEndian(std::vector<std::uint8_t> &bytes, const T value)
+    {
+        std::uint8_t raw[sizeof(T)];
+        std::memcpy(raw, &value, sizeof(T));
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            bytes.push_back(raw[i]);
+    }
+
+    void appendString(std::vector<std::uint8_t> &bytes, const char* text)
+    {
+        bytes.insert(bytes.end(), text, text + std::strlen(text) + 1);
+    }
+
+    void appendAttribute(std::vector<std::uint8_t> &header, const char* name, const char* type, const std::vector<std::uint8_t> &value)
+    {
+        appendString(header, name);
+        appendString(header, type);
+        appendLittleEndian(header, static_cast<std::int32_t>(value.size()));
+        header.insert(header.end(), value.begin(), value.end());
+    }
+
+    std::uint8_t toByte(const float value)
+    {
+        return static_cast<std::uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    std::string lowercaseExtension(const std::filesystem::path &path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    template <typename Writer>
+    std::unique_ptr<raymarch::ImageStreamWriter> openWriter(const std::filesystem::path &path, const sf::Vector2u &size)
+    {
+        auto writer = std::make_unique<Writer>(path, size);
+        if (!writer->isOpen())
+        {
+            std::cerr << "Failed to open " << path << " for writing" << std::endl;
+            return nullptr;
+        }
+        return writer;
+    }
+}
+
+bool raymarch::ImageStreamWriter::isBottomUp() const
+{
+    return false;
+}
+
+std::unique_ptr<raymarch::ImageStreamWriter> raymarch::createImageWriter(const std::filesystem::path &path, const sf::Vector2u &size)
+{
+    const std::string extension = lowercaseExtension(path);
+    if (extension == ".png") return openWriter<PngStreamWriter>(path, size);
+    if (extension == ".exr") return openWriter<ExrStreamWriter>(path, size);
+    if (extension == ".pfm") return openWriter<PfmStreamWriter>(path, size);
+
+    std::cerr << "Unsupported image format " << extension << ", use .png, .exr or .pfm" << std::endl;
+    return nullptr;
+}
+
+raymarch::PngStreamWriter::PngStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size) :
+    _file(path, std::ios::binary),
+    _size(size),
+    _scanline(1 + static_cast<std::size_t>(size.x) * 3)
+{
+    if (!_file) return;
+
+    static constexpr std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    _file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    // 8-bit truecolour, no interlacing
+    std::vector<std::uint8_t> header;
+    appendBigEndian(header, size.x);
+    appendBigEndian(header, size.y);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    writeChunk("IHDR", header);
+}
+
+bool raymarch::PngStreamWriter::isOpen() const
+{
+    return _file.is_open() && _file.good();
+}
+
+bool raymarch::PngStreamWriter::writeRow(const float* rgb)
+{
+    if (_row >= _size.y) return false;
+
+    // Filter type 0, the row is stored as is
+    _scanline[0] = 0;
+    for (std::size_t i = 0; i < static_cast<std::size_t>(_size.x) * 3; ++i)
+        _scanline[i + 1] = toByte(rgb[i]);
+    _adler = adler32(_scanline.data(), _scanline.size(), _adler);
+
+    _chunk.clear();
+    if (_row == 0)
+        _chunk.insert(_chunk.end(), {0x78, 0x01});
+
+    // The row as stored deflate blocks, the last block of the image is flagged as final
+    const bool lastRow = _row + 1 == _size.y;
+    for (std::size_t offset = 0; offset < _scanline.size(); offset += maxStoredBlock)
+    {
+        const std::size_t length = std::min(maxStoredBlock, _scanline.size() - offset);
+        const bool finalBlock = lastRow && offset + length == _scanline.size();
+
+        _chunk.push_back(finalBlock ? 1 : 0);
+        _chunk.push_back(static_cast<std::uint8_t>(length & 0xFF));
+        _chunk.push_back(static_cast<std::uint8_t>(length >> 8));
+        _chunk.push_back(static_cast<std::uint8_t>(~length & 0xFF));
+        _chunk.push_back(static_cast<std::uint8_t>((~length >> 8) & 0xFF));
+        _chunk.insert(_chunk.end(), _scanline.begin() + static_cast<std::ptrdiff_t>(offset), _scanline.begin() + static_cast<std::ptrdiff_t>(offset + length));
+    }
+
+    if (lastRow)
+        appendBigEndian(_chunk, _adler);
+
+    writeChunk("IDAT", _chunk);
+    ++_row;
+    return _file.good();
+}
+
+bool raymarch::PngStreamWriter::finish()
+{
+    if (_row != _size.y)
+    {
+        std::cerr << "PNG is missing " << _size.y - _row << " rows" << std::endl;
+        return false;
+    }
+
+    writeChunk("IEND", {});
+    _file.close();
+    return !_file.fail();
+}
+
+void raymarch::PngStreamWriter::writeChunk(const char* type, const std::vector<std::uint8_t> &data)
+{
+    std::vector<std::uint8_t> length;
+    appendBigEndian(length, static_cast<std::uint32_t>(data.size()));
+    _file.write(reinterpret_cast<const char*>(length.data()), 4);
+
+    // The CRC covers the chunk type and its data
+    const auto* typeBytes = reinterpret_cast<const std::uint8_t*>(type);
+    std::uint32_t crc = crc32(typeBytes, 4);
+    crc = crc32(data.data(), data.size(), crc);
+
+    _file.write(type, 4);
+    _file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    std::vector<std::uint8_t> checksum;
+    appendBigEndian(checksum, crc);
+    _file.write(reinterpret_cast<const char*>(checksum.data()), 4);
+}
+
+raymarch::ExrStreamWriter::ExrStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size) :
+    _file(path, std::ios::binary),
+    _size(size)
+{
+    if (!_file) return;
+
+    std::vector<std::uint8_t> header;
+    appendLittleEndian(header, static_cast<std::int32_t>(20000630));
+    appendLittleEndian(header, static_cast<std::int32_t>(2));
+
+    // Channels are listed alphabetically, all 32-bit float
+    std::vector<std::uint8_t> channels;
+    for (const char* name : {"B", "G", "R"})
+    {
+        appendString(channels, name);
+        appendLittleEndian(channels, static_cast<std::int32_t>(2));
+        channels.insert(channels.end(), {0, 0, 0, 0});
+        appendLittleEndian(channels, static_cast<std::int32_t>(1));
+        appendLittleEndian(channels, static_cast<std::int32_t>(1));
+    }
+    channels.push_back(0);
+    appendAttribute(header, "channels", "chlist", channels);
+
+    appendAttribute(header, "compression", "compression", {0});
+
+    std::vector<std::uint8_t> window;
+    appendLittleEndian(window, static_cast<std::int32_t>(0));
+    appendLittleEndian(window, static_cast<std::int32_t>(0));
+    appendLittleEndian(window, static_cast<std::int32_t>(size.x) - 1);
+    appendLittleEndian(window, static_cast<std::int32_t>(size.y) - 1);
+    appendAttribute(header, "dataWindow", "box2i", window);
+    appendAttribute(header, "displayWindow", "box2i", window);
+
+    appendAttribute(header, "lineOrder", "lineOrder", {0});
+
+    std::vector<std::uint8_t> value;
+    appendLittleEndian(value, 1.0f);
+    appendAttribute(header, "pixelAspectRatio", "float", value);
+    appendAttribute(header, "screenWindowWidth", "float", value);
+
+    value.clear();
+    appendLittleEndian(value, 0.0f);
+    appendLittleEndian(value, 0.0f);
+    appendAttribute(header, "screenWindowCenter", "v2f", value);
+    header.push_back(0);
+
+    // Uncompressed blocks all have the same size, so the offset table is known up front
+    const std::uint64_t blockSize = 8 + static_cast<std::uint64_t>(size.x) * 3 * sizeof(float);
+    const std::uint64_t firstBlock = header.size() + static_cast<std::uint64_t>(size.y) * sizeof(std::uint64_t);
+    for (unsigned int y = 0; y < size.y; ++y)
+        appendLittleEndian(header, firstBlock + y * blockSize);
+
+    _file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    _block.reserve(blockSize);
+}
+
+bool raymarch::ExrStreamWriter::isOpen() const
+{
+    return _file.is_open() && _file.good();
+}
+
+bool raymarch::ExrStreamWriter::writeRow(const float* rgb)
+{
+    if (_row >= _size.y) return false;
+
+    _block.clear();
+    appendLittleEndian(_block, static_cast<std::int32_t>(_row));
+    appendLittleEndian(_block, static_cast<std::int32_t>(_size.x * 3 * sizeof(float)));
+
+    // One channel after the other within the scanline
+    for (const int channel : {2, 1, 0})
+        for (unsigned int x = 0; x < _size.x; ++x)
+            appendLittleEndian(_block, rgb[x * 3 + channel]);
+
+    _file.write(reinterpret_cast<const char*>(_block.data()), static_cast<std::streamsize>(_block.size()));
+    ++_row;
+    return _file.good();
+}
+
+bool raymarch::ExrStreamWriter::finish()
+{
+    if (_row != _size.y)
+    {
+        std::cerr << "EXR is missing " << _size.y - _row << " scanlines" << std::endl;
+        return false;
+    }
+
+    _file.close();
+    return !_file.fail();
+}
+
+raymarch::PfmStreamWriter::PfmStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size) :
+    _file(path, std::ios::binary),
+    _size(size)
+{
+    if (!_file) return;
+
+    // A negative scale marks little-endian data
+    _file << "PF\n" << size.x << " " << size.y << "\n-1.0\n";
+}
+
+bool raymarch::PfmStreamWriter::isOpen() const
+{
+    return _file.is_open() && _file.good();
+}
+
+bool raymarch::PfmStreamWriter::writeRow(const float* rgb)
+{
+    if (_row >= _size.y) return false;
+
+    std::vector<std::uint8_t> row;
+    row.reserve(static_cast<std::size_t>(_size.x) * 3 * sizeof(float));
+    for (std::size_t i = 0; i < static_cast<std::size_t>(_size.x) * 3; ++i)
+        appendLittleEndian(row, rgb[i]);
+
+    _file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    ++_row;
+    return _file.good();
+}
+
+bool raymarch::PfmStreamWriter::finish()
+{
+    if (_row != _size.y)
+    {
+        std::cerr << "PFM is missing " << _size.y - _row << " rows" << std::endl;
+        return false;
+    }
+
+    _file.close();
+    return !_file.fail();
+}
+
+bool raymarch::PfmStreamWriter::isBottomUp() const
+{
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Writes an image one row of linear RGB floats at a time, so the whole image never has to be in memory
+    class ImageStreamWriter
+    {
+    public:
+        virtual ~ImageStreamWriter() = default;
+
+        // Rows go top to bottom, or bottom to top for bottom-up formats
+        virtual bool writeRow(const float* rgb) = 0;
+        virtual bool finish() = 0;
+        [[nodiscard]] virtual bool isBottomUp() const;
+    };
+
+    // Picks PNG, EXR or PFM from the file extension, nullptr if the format is unknown or the file cannot be opened
+    [[nodiscard]] std::unique_ptr<ImageStreamWriter> createImageWriter(const std::filesystem::path &path, const sf::Vector2u &size);
+
+    // 8-bit RGB, stored deflate blocks so no compression library is needed
+    class PngStreamWriter : public ImageStreamWriter
+    {
+    public:
+        PngStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size);
+
+        [[nodiscard]] bool isOpen() const;
+        bool writeRow(const float* rgb) override;
+        bool finish() override;
+    private:
+        std::ofstream _file;
+        sf::Vector2u _size;
+        unsigned int _row = 0;
+        std::uint32_t _adler = 1;
+        std::vector<std::uint8_t> _scanline;
+        std::vector<std::uint8_t> _chunk;
+
+        void writeChunk(const char* type, const std::vector<std::uint8_t> &data);
+    };
+
+    // Uncompressed 32-bit float scanlines
+    class ExrStreamWriter : public ImageStreamWriter
+    {
+    public:
+        ExrStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size);
+
+        [[nodiscard]] bool isOpen() const;
+        bool writeRow(const float* rgb) override;
+        bool finish() override;
+    private:
+        std::ofstream _file;
+        sf::Vector2u _size;
+        unsigned int _row = 0;
+        std::vector<std::uint8_t> _block;
+    };
+
+    // Portable float map, stored bottom row first
+    class PfmStreamWriter : public ImageStreamWriter
+    {
+    public:
+        PfmStreamWriter(const std::filesystem::path &path, const sf::Vector2u &size);
+
+        [[nodiscard]] bool isOpen() const;
+        bool writeRow(const float* rgb) override;
+        bool finish() override;
+        [[nodiscard]] bool isBottomUp() const override;
+    private:
+        std::ofstream _file;
+        sf::Vector2u _size;
+        unsigned int _row = 0;
+    };
+}
@@ -1,5 +1,4 @@
 #include "inputhandler.hpp"
-#include "config.hpp"
 
 sf::Vector3f raymarch::InputHandler::getNormalizedMovement()
 {
@@ -21,11 +20,15 @@ sf::Vector3f raymarch::InputHandler::getNormalizedMovement()
 
 sf::Vector3f raymarch::InputHandler::getNormalizedRotation(const sf::Window& window)
 {
+    // The window's own size, config belongs to the render thread
+    const sf::Vector2u size = window.getSize();
+    const sf::Vector2i center {static_cast<int>(size.x / 2), static_cast<int>(size.y / 2)};
+
     // Getting mouse delta
-    const sf::Vector2f mouseDelta2D = static_cast<sf::Vector2f>(sf::Mouse::getPosition(window) - config::windowCenter).componentWiseDiv(config::windowSizeF) * 2.0f;
+    const sf::Vector2f mouseDelta2D = static_cast<sf::Vector2f>(sf::Mouse::getPosition(window) - center).componentWiseDiv(static_cast<sf::Vector2f>(size)) * 2.0f;
 
     // Resetting mouse position
-    sf::Mouse::setPosition(config::windowCenter, window);
+    sf::Mouse::setPosition(center, window);
 
     // Getting rotation on the Z-axis (roll)
     sf::Vector3f rotation = sf::Vector3f(mouseDelta2D.x, mouseDelta2D.y, 0);
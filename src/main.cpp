@@ -1,123 +1,314 @@
+#include <atomic>
 #include <cmath>
 #include <iostream>
-#include <random>
+#include <thread>
 #include <SFML/Graphics.hpp>
 
+#include "animation.hpp"
+#include "benchmark.hpp"
+#include "bookmarks.hpp"
 #include "camera.hpp"
+#include "camerapath.hpp"
+#include "commandqueue.hpp"
 #include "helpers.hpp"
 #include "config.hpp"
+#include "cpurenderer.hpp"
 #include "eventhandler.hpp"
+#include "framecapture.hpp"
+#include "framepacer.hpp"
+#include "golden.hpp"
+#include "options.hpp"
+#include "poster.hpp"
+#include "profiler.hpp"
+#include "renderer.hpp"
+#include "resolutionscaler.hpp"
+#include "triplebuffer.hpp"
 
-int main()
+int main(int argc, char** argv)
 {
-    // Creating window
-    auto window = sf::RenderWindow(sf::VideoMode(config::windowSize), "Fractal SFML", (config::isFullscreen) ? sf::State::Fullscreen : sf::State::Windowed);
-    window.setFramerateLimit(config::maxFrameRate);
-    window.setMouseCursorVisible(false);
-    sf::Mouse::setPosition(config::windowCenter, window);
+    const std::optional<raymarch::Options> options = raymarch::parseOptions(argc, argv);
+    if (!options) return 1;
 
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_real_distribution<float> jitterDist(-0.5f, 0.5f);
+    // Headless benchmark, no window is created
+    if (options->mode == raymarch::RunMode::Benchmark)
+    {
+        raymarch::Benchmark benchmark {*options};
+        return benchmark.run();
+    }
 
-    // Fullscreen-Quad that is the "canvas" for our renderer
-    sf::RectangleShape fullScreenQuad {config::windowSizeF};
-    fullScreenQuad.setFillColor(sf::Color::Red);
+    // CPU renderer against shader comparison
+    if (options->mode == raymarch::RunMode::Golden)
+    {
+        const raymarch::GoldenTest goldenTest {*options};
+        return goldenTest.run();
+    }
 
-    // Accumulation texture
-    // Accumulation textures (ping-pong)
-    sf::RenderTexture accumulation[2]
+    // Offline tiled render straight to an image file
+    if (options->mode == raymarch::RunMode::Poster)
     {
-        {config::windowSize},
-        {config::windowSize}
-    };
-    accumulation[0].clear();
-    accumulation[1].clear();
+        const raymarch::PosterRenderer posterRenderer {*options};
+        return posterRenderer.run();
+    }
 
-    int pingpong = 0;
+    // Recorded camera path, rendered frame by frame
+    if (options->mode == raymarch::RunMode::Animation)
+    {
+        const raymarch::AnimationRenderer animationRenderer {*options};
+        return animationRenderer.run();
+    }
 
+    // Creating window
+    auto window = sf::RenderWindow(sf::VideoMode(config::windowSize), "Fractal SFML", (config::isFullscreen) ? sf::State::Fullscreen : sf::State::Windowed);
+    // The frame pacer replaces the limit, it also decides when a frame starts
+    window.setFramerateLimit(config::framePacing ? 0 : config::maxFrameRate);
+    window.setMouseCursorVisible(false);
+    sf::Mouse::setPosition(config::windowCenter, window);
 
-    // Ray-marching shader
-    sf::Shader shader;
-    if (!shader.loadFromFile("shaders/main.frag", sf::Shader::Type::Fragment))
+    // Ray-marching renderer with its accumulation buffers
+    raymarch::Renderer renderer {config::windowSize};
+    renderer.setDistanceVolume(options->distanceVolume);
+    if (!renderer.loadShader("shaders/main.frag"))
     {
-        std::cerr << "Failed to load fragment shader" << std::endl;
         return 1;
     }
-    shader.setUniform("iResolution", config::windowSizeF);
-    shader.setUniform("maxDistance", 10000.0f);
-    shader.setUniform("epsilon", 0.00001f);
-    shader.setUniform("iterations", 1000);
-    shader.setUniform("power", 8.0f);
-    shader.setUniform("iTime", 0.0f);
-    shader.setUniform("lastFrame", accumulation[pingpong].getTexture());
-    shader.setUniform("blendFactor", 0.95f);
-    shader.setUniform("accumulate", true);
+    raymarch::FractalParameters parameters = renderer.getParameters();
+    parameters.fractal = options->fractal;
+    parameters.normals = options->normals;
+    renderer.setParameters(parameters);
+    renderer.setFrameBudget(config::frameBudget);
+    renderer.setConePrepass(options->conePrepass);
+    renderer.setReprojection(config::reprojection);
+    renderer.setHotReload(config::shaderHotReload);
+
+    // Pass timings for the overlay and the CSV trace
+    raymarch::Profiler profiler;
+    renderer.setProfiler(&profiler);
+
+    // Software fallback for machines without a usable GPU
+    std::optional<raymarch::CpuRenderer> cpuRenderer;
+    if (options->cpu)
+    {
+        cpuRenderer.emplace(config::windowSize, options->threads);
+        cpuRenderer->setParameters(renderer.getParameters());
+    }
 
     // Camera
     constexpr sf::Vector3f cameraPosition {0.001, 0, -4};
     constexpr sf::Vector3f cameraTarget {0, 0, 2};
     constexpr float fov = 90;
     raymarch::Camera camera { config::windowSizeF, cameraPosition, cameraTarget, fov, 1.0f };
+    camera.setDeepZoom(options->deepZoom);
 
 
-    // Event handler
-    raymarch::EventHandler eventHandler {window, fullScreenQuad, shader, camera};
+    // Dynamic resolution during camera motion
+    raymarch::ResolutionScaler resolutionScaler {1000.0f / static_cast<float>(config::maxFrameRate)};
 
-    unsigned int frameId = 0;
+    // Screenshots and frame sequences, encoded off the render thread
+    raymarch::FrameCapture capture;
 
-    sf::Clock clock;
-    sf::Time previousTime = sf::Time::Zero;
+    // Keyframes of the interactive camera for headless playback
+    raymarch::CameraRecorder cameraRecorder {config::cameraKeyInterval};
 
-    // Loop
-    while (window.isOpen())
+    // Saved views with their thumbnails, and the flight to one of them
+    raymarch::BookmarkStore bookmarks {config::bookmarkDirectory};
+    bookmarks.load();
+    raymarch::CameraFlight cameraFlight;
+
+    // Commands between the render thread and the input thread, camera snapshots without a lock
+    raymarch::CommandQueue renderCommands;
+    raymarch::CommandQueue inputCommands;
+    raymarch::TripleBuffer<raymarch::CameraSnapshot> cameraSnapshots {{camera, false, std::chrono::steady_clock::now()}};
+    std::atomic<bool> rendering = true;
+
+    // Event handler
+    raymarch::EventHandler eventHandler {window, renderer, camera, profiler, capture, cameraRecorder, bookmarks, cameraFlight, renderCommands, inputCommands};
+
+    // The render loop draws on its own thread, a slow frame no longer holds back input and camera motion
+    if (!window.setActive(false))
     {
-        // Updating the time
-        sf::Time elapsedTime = clock.getElapsedTime();
-        float deltaTime = (elapsedTime - previousTime).asSeconds();
-        float iTime = elapsedTime.asSeconds();
-        previousTime = elapsedTime;
+        std::cerr << "Failed to release the window context" << std::endl;
+        return 1;
+    }
 
-        // Processing window events
-        // processEvents(window, fullScreenQuad, shader);
-        eventHandler.handleEvents(deltaTime);
+    std::thread renderThread([&]
+    {
+        if (!window.setActive(true))
+        {
+            std::cerr << "Failed to activate the window context on the render thread" << std::endl;
+            rendering = false;
+            return;
+        }
 
-        // Updating shader uniforms related to the camera
-        updateShader(shader, camera, iTime);
+        unsigned int frameId = 0;
 
-        // Ping-pong buffers
-        int readIndex = pingpong;
-        int writeIndex = 1 - pingpong;
+        // Needs the active context for its fences
+        raymarch::FramePacer pacer {1000.0f / static_cast<float>(config::maxFrameRate)};
 
-        // Set last frame for temporal blending
-        shader.setUniform("lastFrame", accumulation[readIndex].getTexture());
+        sf::Clock clock;
+        sf::Clock renderClock;
 
-        sf::Vector2f jitter{
-            jitterDist(rng) / config::windowSizeF.x,
-            jitterDist(rng) / config::windowSizeF.y
+        // GPU times of the motion frames from the profiler's timer queries, they arrive a few frames late
+        raymarch::PassTimeQueue scaledTimes {raymarch::Pass::Accumulation};
+        const auto updateScaler = [&] {
+            while (const std::optional<raymarch::PassTimeQueue::Timing> timing = scaledTimes.poll(profiler))
+                resolutionScaler.update(timing->milliseconds, timing->work);
         };
 
-        shader.setUniform("jitter", jitter);
-        // Optional: Reset accumulation if camera moved
-        bool camMoved = camera.isMoving(); // Implement this in your Camera class
-        shader.setUniform("accumulate", !camMoved);
-        if (camMoved) {
-            accumulation[writeIndex].clear(sf::Color::Black);
+        sf::Time lastStepSample = sf::Time::Zero;
+
+        // Loop
+        while (rendering)
+        {
+            // Starting as late as the predicted frame cost allows, the camera read below is as fresh as it can be
+            if (config::framePacing)
+                pacer.waitForFrameStart();
+
+            // Key presses that reach the renderer, then the newest camera the input thread has published
+            const bool commandsRan = renderCommands.run();
+            const raymarch::CameraSnapshot snapshot = cameraSnapshots.read();
+            const raymarch::Camera& camera = snapshot.camera;
+
+            // A converged image with nothing drawn over it is already on screen
+            const bool unchanged = !cpuRenderer && !commandsRan && !snapshot.moving && renderer.isFinal(camera)
+                                   && renderer.getHeatmap() == raymarch::HeatmapChannel::None && !capture.isRecording()
+                                   && !profiler.isOverlayVisible() && !bookmarks.isOverlayVisible();
+            if (config::framePacing && config::skipConvergedPresents && !pacer.shouldPresent(unchanged))
+                continue;
+
+            // Updating the time
+            sf::Time elapsedTime = clock.getElapsedTime();
+            float iTime = elapsedTime.asSeconds();
+
+            profiler.beginFrame();
+
+            // Recompiled shaders are swapped in between frames
+            renderer.applyShaderReload();
+
+            window.clear();
+
+            if (cpuRenderer)
+            {
+                if (cpuRenderer->getResolution() != config::windowSize)
+                    cpuRenderer->resize(config::windowSize);
+
+                cpuRenderer->render(camera);
+
+                // Display result
+                const sf::Sprite displaySprite(cpuRenderer->getTexture());
+                window.draw(displaySprite);
+            }
+            else
+            {
+                // Reset accumulation if camera moved, a flight counts until it has arrived
+                const bool camMoved = snapshot.moving;
+
+                if (renderer.getHeatmap() != raymarch::HeatmapChannel::None)
+                {
+                    // Diagnostic counters instead of the image
+                    renderer.renderDiagnostics(camera, iTime);
+                }
+                else if (camMoved && config::adaptiveResolution && (!renderer.isReprojecting() || resolutionScaler.getScale() < 1.0f))
+                {
+                    // The scale follows the GPU cost of the march itself
+                    const float scale = resolutionScaler.getScale();
+                    if (profiler.hasGpuTimers())
+                    {
+                        renderer.renderScaled(camera, iTime, scale);
+                        scaledTimes.push(profiler, scale);
+                        updateScaler();
+                    }
+                    else
+                    {
+                        // Without timer queries the cost is only known once the GPU is done
+                        renderClock.restart();
+                        renderer.renderScaled(camera, iTime, scale);
+                        renderer.finish();
+                        resolutionScaler.update(static_cast<float>(renderClock.getElapsedTime().asMicroseconds()) / 1000.0f);
+                    }
+                }
+                else if (renderer.isReprojecting())
+                {
+                    // History follows the camera, accumulation never stops
+                    renderer.render(camera, iTime, true);
+
+                    // Full resolution motion frames are timed too, over budget the scaler takes over from reprojection
+                    if (camMoved && config::adaptiveResolution && profiler.hasGpuTimers())
+                    {
+                        scaledTimes.push(profiler, 1.0f);
+                        updateScaler();
+                    }
+                }
+                else
+                {
+                    // Full resolution as soon as accumulation resumes
+                    renderer.render(camera, iTime, !camMoved);
+                }
+
+                // Display result, upscaled and with the finished tiles of the pass in progress
+                renderer.draw(window);
+                profiler.setSampleCount(renderer.getSampleCount(), renderer.isConverged());
+
+                // Average march steps for the overlay, counted in an extra frame now and then
+                if (profiler.isOverlayVisible() && (elapsedTime - lastStepSample).asSeconds() >= config::stepSampleInterval)
+                {
+                    const raymarch::StepCount steps = renderer.countSteps(camera, iTime);
+                    profiler.setAverageSteps(static_cast<float>(steps.total()) / static_cast<float>(steps.pixels));
+                    lastStepSample = elapsedTime;
+                }
+            }
+
+            // Captured without the overlay
+            capture.capture(window);
+
+            profiler.drawOverlay(window);
+            bookmarks.drawOverlay(window);
+            profiler.endFrame();
+
+            // Waiting for the GPU before presenting, the pacer learns the frame's cost and nothing queues up behind it
+            if (config::framePacing)
+                pacer.endRender();
+
+            // Presenting may wait for vsync, it is not counted as CPU time
+            window.display();
+            pacer.presented(snapshot.sampleTime, snapshot.moving);
+            if (snapshot.moving)
+                profiler.setLatency(pacer.getLastLatency());
+
+            // Thumbnails of new bookmarks are rendered after the frame is presented
+            if (!cpuRenderer)
+                bookmarks.renderThumbnails(renderer, camera);
+
+            ++frameId;
         }
 
-        // Render to write buffer
-        accumulation[writeIndex].clear();
-        accumulation[writeIndex].draw(fullScreenQuad, &shader);
-        accumulation[writeIndex].display();
+        // Readbacks in flight need the window context
+        capture.flush();
+        (void)window.setActive(false);
+        pacer.printSummary();
+    });
 
-        // Display result
-        sf::Sprite displaySprite(accumulation[writeIndex].getTexture());
-        window.clear();
-        window.draw(displaySprite);
-        window.display();
+    // Input and camera integration at a fixed rate, the smoothing no longer depends on the frame time
+    const sf::Time tick = sf::seconds(1.0f / static_cast<float>(config::inputRate));
+    sf::Clock inputClock;
+    sf::Time nextTick = sf::Time::Zero;
 
-        // Swap
-        pingpong = writeIndex;
+    while (rendering && !eventHandler.isCloseRequested())
+    {
+        // Processing window events
+        eventHandler.handleEvents(tick.asSeconds());
+        cameraRecorder.update(camera);
+        cameraSnapshots.publish({camera, camera.isMoving() || cameraFlight.isActive(), std::chrono::steady_clock::now()});
 
-        ++frameId;
+        // Ticks missed by a stall are dropped rather than run back to back
+        nextTick += tick;
+        const sf::Time now = inputClock.getElapsedTime();
+        if (nextTick > now)
+            sf::sleep(nextTick - now);
+        else
+            nextTick = now;
     }
+
+    rendering = false;
+    renderThread.join();
+    window.close();
 }
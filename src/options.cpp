@@ -0,0 +1,287 @@
+#include "options.hpp"
+
+#include <iostream>
+#include <string>
+
+#include "config.hpp"
+
+namespace
+{
+    void printUsage(const char* program)
+    {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --benchmark [frames]    Render frames headless and report frame times\n"
+                  << "  --golden                Compare the CPU renderer against the shader\n"
+                  << "  --poster <width>x<height> Render a tiled image offline and write it to the output file\n"
+                  << "  --animate <file>        Render a recorded .campath headless, frame by frame\n"
+                  << "  --camera-path <file>    Poster view from the first keyframe of a .campath\n"
+                  << "  --bookmark <slot>       Poster view and fractal from a saved bookmark (1-9)\n"
+                  << "  --samples <count>       Accumulated samples per pixel of a poster or animation frame (default " << config::posterSamples << ")\n"
+                  << "  --fps <rate>            Frame rate of the animation (default " << config::animationFrameRate << ")\n"
+                  << "  --pipe <command>        Pipe raw rgb24 animation frames to an encoder instead of writing images\n"
+                  << "  --cpu                   Render with the multithreaded CPU renderer\n"
+                  << "  --threads <count>       CPU renderer worker threads (default: all cores)\n"
+                  << "  --no-prepass            Disable the cone-marching pre-pass\n"
+                  << "  --no-volume             Shadows march the exact estimator instead of the baked distance volume\n"
+                  << "  --deep-zoom             Exponential zoom around a double precision reference point, mandelbox only (up to " << config::deepZoomLimit << "x)\n"
+                  << "  --fractal <name>        mandelbulb, mandelbox or kleinian (default mandelbulb)\n"
+                  << "  --normals <name>        central, tetrahedral, forward or analytic normals (default central)\n"
+                  << "  --compare-normals       Time every normal estimator and measure its error against central differences\n"
+                  << "  --count-steps           Count distance estimator calls with and without the pre-pass\n"
+                  << "  --warmup <frames>       Frames rendered before measuring (default " << config::benchmarkWarmupFrames << ")\n"
+                  << "  --size <width>x<height> Render resolution\n"
+                  << "  --seed <value>          Scramble seed of the sampler (default " << config::benchmarkSeed << ")\n"
+                  << "  --output <file>         Benchmark JSON summary (default benchmark.json), the .png, .exr or .pfm poster\n"
+                  << "                          (default poster.png) or the animation frame pattern (default frames/frame.png)\n"
+                  << "  --help                  Show this message" << std::endl;
+    }
+
+    bool parseUnsigned(const std::string& text, uint32_t& value)
+    {
+        try
+        {
+            std::size_t parsed = 0;
+            const unsigned long result = std::stoul(text, &parsed);
+            if (parsed != text.size()) return false;
+            value = static_cast<uint32_t>(result);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    bool parseSize(const std::string& text, sf::Vector2u& size)
+    {
+        const std::size_t separator = text.find('x');
+        if (separator == std::string::npos) return false;
+
+        uint32_t width, height;
+        if (!parseUnsigned(text.substr(0, separator), width) || !parseUnsigned(text.substr(separator + 1), height))
+            return false;
+        if (width == 0 || height == 0) return false;
+
+        size = {width, height};
+        return true;
+    }
+}
+
+std::optional<raymarch::Options> raymarch::parseOptions(const int argc, char** argv)
+{
+    Options options;
+    options.resolution = config::windowSize;
+    options.frames = config::benchmarkFrames;
+    options.warmupFrames = config::benchmarkWarmupFrames;
+    options.seed = config::benchmarkSeed;
+    options.samples = config::posterSamples;
+    options.frameRate = config::animationFrameRate;
+    bool outputSet = false;
+    options.conePrepass = config::conePrepass;
+    options.deepZoom = config::deepZoom;
+    options.distanceVolume = config::distanceVolume;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+
+        if (argument == "--help" || argument == "-h")
+        {
+            printUsage(argv[0]);
+            return std::nullopt;
+        }
+        if (argument == "--benchmark")
+        {
+            options.mode = RunMode::Benchmark;
+            if (hasValue && !parseUnsigned(argv[++i], options.frames))
+            {
+                std::cerr << "Invalid frame count: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--golden")
+        {
+            options.mode = RunMode::Golden;
+        }
+        else if (argument == "--poster" && hasValue)
+        {
+            options.mode = RunMode::Poster;
+            if (!parseSize(argv[++i], options.resolution))
+            {
+                std::cerr << "Invalid poster size: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--animate" && hasValue)
+        {
+            options.mode = RunMode::Animation;
+            options.cameraPath = argv[++i];
+        }
+        else if (argument == "--camera-path" && hasValue)
+        {
+            options.cameraPath = argv[++i];
+        }
+        else if (argument == "--bookmark" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.bookmark) || options.bookmark == 0)
+            {
+                std::cerr << "Invalid bookmark slot: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--fps" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.frameRate) || options.frameRate == 0)
+            {
+                std::cerr << "Invalid frame rate: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--pipe" && hasValue)
+        {
+            options.pipeCommand = argv[++i];
+        }
+        else if (argument == "--samples" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.samples) || options.samples == 0)
+            {
+                std::cerr << "Invalid sample count: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--cpu")
+        {
+            options.cpu = true;
+        }
+        else if (argument == "--no-prepass")
+        {
+            options.conePrepass = false;
+        }
+        else if (argument == "--no-volume")
+        {
+            options.distanceVolume = false;
+        }
+        else if (argument == "--deep-zoom")
+        {
+            options.deepZoom = true;
+        }
+        else if (argument == "--count-steps")
+        {
+            options.countSteps = true;
+        }
+        else if (argument == "--fractal" && hasValue)
+        {
+            const std::optional<FractalType> fractal = parseFractalType(argv[++i]);
+            if (!fractal)
+            {
+                std::cerr << "Unknown fractal: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+            options.fractal = *fractal;
+        }
+        else if (argument == "--normals" && hasValue)
+        {
+            const std::optional<NormalMode> normals = parseNormalMode(argv[++i]);
+            if (!normals)
+            {
+                std::cerr << "Unknown normal estimator: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+            options.normals = *normals;
+        }
+        else if (argument == "--compare-normals")
+        {
+            options.compareNormals = true;
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.threads))
+            {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--warmup" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.warmupFrames))
+            {
+                std::cerr << "Invalid warmup frame count: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--size" && hasValue)
+        {
+            if (!parseSize(argv[++i], options.resolution))
+            {
+                std::cerr << "Invalid size: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--seed" && hasValue)
+        {
+            if (!parseUnsigned(argv[++i], options.seed))
+            {
+                std::cerr << "Invalid seed: " << argv[i] << std::endl;
+                return std::nullopt;
+            }
+        }
+        else if (argument == "--output" && hasValue)
+        {
+            options.outputPath = argv[++i];
+            outputSet = true;
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            printUsage(argv[0]);
+            return std::nullopt;
+        }
+    }
+
+    // The CPU renderer only ports the Mandelbulb estimator
+    if ((options.cpu || options.mode == RunMode::Golden) && options.fractal != FractalType::Mandelbulb)
+    {
+        std::cerr << "The CPU renderer only supports the mandelbulb" << std::endl;
+        return std::nullopt;
+    }
+
+    // Its normals are the central differences the other estimators are measured against
+    if (options.cpu && options.normals != NormalMode::Central)
+    {
+        std::cerr << "The CPU renderer only supports central difference normals" << std::endl;
+        return std::nullopt;
+    }
+
+    // Only the Mandelbox estimator iterates offsets from the reference point, the others stop at float precision
+    if (options.deepZoom && options.fractal != FractalType::Mandelbox)
+    {
+        std::cerr << "Deep zoom only supports the mandelbox" << std::endl;
+        return std::nullopt;
+    }
+
+    if (options.mode == RunMode::Poster || options.mode == RunMode::Animation)
+    {
+        if (options.cpu)
+        {
+            std::cerr << "Offline renders use the shader, --cpu is not supported" << std::endl;
+            return std::nullopt;
+        }
+        if (!outputSet)
+            options.outputPath = options.mode == RunMode::Poster ? "poster.png" : "frames/frame.png";
+    }
+
+    if (options.mode == RunMode::Poster && !options.cameraPath.empty() && options.bookmark != 0)
+    {
+        std::cerr << "The poster view comes from either --camera-path or --bookmark" << std::endl;
+        return std::nullopt;
+    }
+
+    if (options.mode == RunMode::Benchmark && options.frames == 0)
+    {
+        std::cerr << "Benchmark needs at least one frame" << std::endl;
+        return std::nullopt;
+    }
+
+    return options;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <SFML/Graphics.hpp>
+
+#include "parameters.hpp"
+
+namespace raymarch
+{
+    enum class RunMode
+    {
+        Interactive,
+        Benchmark,
+        Golden,
+        Poster,
+        Animation
+    };
+
+    struct Options
+    {
+        RunMode mode = RunMode::Interactive;
+        sf::Vector2u resolution;
+        uint32_t frames;
+        uint32_t warmupFrames;
+        uint32_t seed;
+        uint32_t samples;
+        uint32_t frameRate;
+        bool cpu = false;
+        uint32_t threads = 0;
+        bool conePrepass;
+        bool deepZoom;
+        bool distanceVolume;
+        bool countSteps = false;
+        bool compareNormals = false;
+        FractalType fractal = FractalType::Mandelbulb;
+        NormalMode normals = NormalMode::Central;
+        std::filesystem::path outputPath = "benchmark.json";
+        std::filesystem::path cameraPath;
+        // 1-based bookmark slot of the poster view, 0 takes the camera path or the home view
+        uint32_t bookmark = 0;
+        std::string pipeCommand;
+    };
+
+    // Returns std::nullopt if the arguments are invalid or help was requested
+    std::optional<Options> parseOptions(int argc, char** argv);
+}
@@ -0,0 +1,82 @@
+#include "parameters.hpp"
+
+#include <cmath>
+
+bool raymarch::FractalParameters::operator==(const FractalParameters &other) const
+{
+    return fractal == other.fractal && power == other.power && iterations == other.iterations &&
+           epsilon == other.epsilon && maxDistance == other.maxDistance && normals == other.normals &&
+           boxScale == other.boxScale && boxFoldLimit == other.boxFoldLimit;
+}
+
+bool raymarch::FractalParameters::operator!=(const FractalParameters &other) const
+{
+    return !(*this == other);
+}
+
+const char* raymarch::getFractalName(const FractalType fractal)
+{
+    switch (fractal)
+    {
+        case FractalType::Mandelbox: return "mandelbox";
+        case FractalType::Kleinian: return "kleinian";
+        default: return "mandelbulb";
+    }
+}
+
+std::optional<raymarch::FractalType> raymarch::parseFractalType(const std::string_view name)
+{
+    for (const FractalType fractal : {FractalType::Mandelbulb, FractalType::Mandelbox, FractalType::Kleinian})
+    {
+        if (name == getFractalName(fractal))
+            return fractal;
+    }
+    return std::nullopt;
+}
+
+const char* raymarch::getNormalModeName(const NormalMode mode)
+{
+    switch (mode)
+    {
+        case NormalMode::Tetrahedral: return "tetrahedral";
+        case NormalMode::Forward: return "forward";
+        case NormalMode::Analytic: return "analytic";
+        default: return "central";
+    }
+}
+
+std::optional<raymarch::NormalMode> raymarch::parseNormalMode(const std::string_view name)
+{
+    for (const NormalMode mode : {NormalMode::Central, NormalMode::Tetrahedral, NormalMode::Forward, NormalMode::Analytic})
+    {
+        if (name == getNormalModeName(mode))
+            return mode;
+    }
+    return std::nullopt;
+}
+
+float raymarch::getBoundingExtent(const FractalParameters &parameters)
+{
+    // Margin for the estimators' iteration limit, their surface reaches slightly past the set
+    constexpr float margin = 1.1f;
+
+    switch (parameters.fractal)
+    {
+        case FractalType::Mandelbulb:
+            // |z^n + c| grows once |c| > 2^(1 / (n - 1)), like the Mandelbrot set at n = 2
+            if (parameters.power <= 1.0f) break;
+            return std::pow(2.0f, 1.0f / (parameters.power - 1.0f)) * margin;
+        case FractalType::Mandelbox:
+        {
+            // Positive scales fill 2f (s + 1) / (s - 1), negative scales stay within the fold limit doubled (sampled up to s = -4)
+            const float scale = std::abs(parameters.boxScale);
+            if (scale <= 1.0f) break;
+            const float extent = parameters.boxScale > 0 ? (scale + 1.0f) / (scale - 1.0f) : 1.0f;
+            return 2.0f * std::abs(parameters.boxFoldLimit) * extent * margin;
+        }
+        default:
+            // The Kleinian folds repeat space in every direction
+            break;
+    }
+    return parameters.maxDistance;
+}
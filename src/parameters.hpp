@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace raymarch
+{
+    // Distance estimator compiled into the shader
+    enum class FractalType
+    {
+        Mandelbulb,
+        Mandelbox,
+        Kleinian
+    };
+
+    // Surface normal at the hit point, the renderer's default is the six-tap central difference
+    enum class NormalMode
+    {
+        Central,
+        Tetrahedral,
+        Forward,
+        Analytic
+    };
+
+    // Fractal and march settings shared by the GPU and CPU renderers
+    struct FractalParameters
+    {
+        FractalType fractal = FractalType::Mandelbulb;
+        float power = 8.0f;
+        int iterations = 1000;
+        float epsilon = 0.00001f;
+        float maxDistance = 10000.0f;
+        NormalMode normals = NormalMode::Central;
+
+        // Mandelbox only
+        float boxScale = -1.5f;
+        float boxFoldLimit = 1.0f;
+
+        bool operator==(const FractalParameters &other) const;
+        bool operator!=(const FractalParameters &other) const;
+    };
+
+    [[nodiscard]] const char* getFractalName(FractalType fractal);
+    [[nodiscard]] std::optional<FractalType> parseFractalType(std::string_view name);
+    [[nodiscard]] const char* getNormalModeName(NormalMode mode);
+    [[nodiscard]] std::optional<NormalMode> parseNormalMode(std::string_view name);
+
+    // Radius of the Mandelbulb's bounding sphere or half-size of the Mandelbox's bounding cube, maxDistance where there is no bound
+    [[nodiscard]] float getBoundingExtent(const FractalParameters &parameters);
+}
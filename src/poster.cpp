@@ -0,0 +1,138 @@
+#include "poster.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bookmarks.hpp"
+#include "camera.hpp"
+#include "camerapath.hpp"
+#include "config.hpp"
+#include "imagewriter.hpp"
+#include "renderer.hpp"
+
+raymarch::PosterRenderer::PosterRenderer(const Options &options) :
+    _options(options)
+{
+}
+
+int raymarch::PosterRenderer::run() const
+{
+    if (!sf::Shader::isAvailable())
+    {
+        std::cerr << "Shaders are not supported by the current GL context" << std::endl;
+        return 1;
+    }
+
+    const sf::Vector2u size = _options.resolution;
+    const unsigned int tileSize = config::posterTileSize;
+
+    // The interactive targets are only needed for uniform defaults, one tile is enough
+    Renderer renderer {{tileSize, tileSize}};
+    renderer.setDistanceVolume(_options.distanceVolume);
+    if (!renderer.loadShader("shaders/main.frag")) return 1;
+
+    Camera camera { static_cast<sf::Vector2f>(size), {0.001, 0, -4}, {0, 0, 2}, 90, 1.0f };
+    camera.setDeepZoom(_options.deepZoom);
+
+    FractalParameters parameters = renderer.getParameters();
+    parameters.fractal = _options.fractal;
+
+    // The view comes from the first keyframe of a camera path or from a bookmark, the home view otherwise
+    if (!_options.cameraPath.empty())
+    {
+        CameraPath path;
+        if (!path.load(_options.cameraPath)) return 1;
+        if (path.isEmpty())
+        {
+            std::cerr << "Camera path " << _options.cameraPath << " has no keyframes" << std::endl;
+            return 1;
+        }
+        camera.setState(path.sample(path.getStartTime()));
+    }
+    else if (_options.bookmark != 0)
+    {
+        BookmarkStore bookmarks {config::bookmarkDirectory};
+        if (!bookmarks.load()) return 1;
+
+        const Bookmark* bookmark = bookmarks.get(_options.bookmark - 1);
+        if (!bookmark)
+        {
+            std::cerr << "No bookmark in slot " << _options.bookmark << std::endl;
+            return 1;
+        }
+
+        // The bookmarked view is only meaningful in the fractal it was saved in
+        camera.setState(bookmark->camera);
+        parameters = bookmark->parameters;
+        if (_options.deepZoom && parameters.fractal != FractalType::Mandelbox)
+        {
+            std::cerr << "Deep zoom only supports the mandelbox, " << bookmark->name << " is not one" << std::endl;
+            return 1;
+        }
+    }
+
+    parameters.normals = _options.normals;
+    renderer.setParameters(parameters);
+    renderer.seed(_options.seed);
+    renderer.setConePrepass(false);
+
+    const std::unique_ptr<ImageStreamWriter> writer = createImageWriter(_options.outputPath, size);
+    if (!writer) return 1;
+
+    std::cout << "Rendering " << size.x << "x" << size.y << " poster with " << _options.samples
+              << " samples per pixel to " << _options.outputPath << std::endl;
+
+    // One band of tiles in RGB, top row first, is all that is kept on the CPU
+    const unsigned int bandCount = (size.y + tileSize - 1) / tileSize;
+    std::vector<float> band(static_cast<std::size_t>(size.x) * tileSize * 3);
+
+    sf::Clock clock;
+    for (unsigned int i = 0; i < bandCount; ++i)
+    {
+        // Bottom-up formats start with the last band
+        const unsigned int bandIndex = writer->isBottomUp() ? bandCount - 1 - i : i;
+        const unsigned int top = bandIndex * tileSize;
+        const unsigned int bandHeight = std::min(tileSize, size.y - top);
+
+        for (unsigned int left = 0; left < size.x; left += tileSize)
+        {
+            const unsigned int tileWidth = std::min(tileSize, size.x - left);
+            const sf::IntRect region {
+                {static_cast<int>(left), static_cast<int>(top)},
+                {static_cast<int>(tileWidth), static_cast<int>(bandHeight)}
+            };
+
+            const std::vector<float> texels = renderer.renderRegion(camera, size, region, _options.samples);
+            if (texels.empty()) return 1;
+
+            // Texel rows are bottom-up, alpha holds the depth and is dropped
+            for (unsigned int y = 0; y < bandHeight; ++y)
+            {
+                const float* source = texels.data() + static_cast<std::size_t>(bandHeight - 1 - y) * tileWidth * 4;
+                float* destination = band.data() + (static_cast<std::size_t>(y) * size.x + left) * 3;
+                for (unsigned int x = 0; x < tileWidth; ++x)
+                    std::copy_n(source + x * 4, 3, destination + x * 3);
+            }
+        }
+
+        for (unsigned int row = 0; row < bandHeight; ++row)
+        {
+            const unsigned int y = writer->isBottomUp() ? bandHeight - 1 - row : row;
+            if (!writer->writeRow(band.data() + static_cast<std::size_t>(y) * size.x * 3))
+            {
+                std::cerr << "Failed to write " << _options.outputPath << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Band " << i + 1 << "/" << bandCount << " done after " << std::fixed << std::setprecision(1)
+                  << clock.getElapsedTime().asSeconds() << " s" << std::endl;
+    }
+
+    if (!writer->finish()) return 1;
+
+    std::cout << "Poster written to " << _options.outputPath << std::endl;
+    return 0;
+}
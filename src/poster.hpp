@@ -0,0 +1,16 @@
+#pragma once
+
+#include "options.hpp"
+
+namespace raymarch
+{
+    // Renders an image of any size as a grid of tiles and streams it to disk, one band of tiles at a time
+    class PosterRenderer
+    {
+    public:
+        explicit PosterRenderer(const Options& options);
+        int run() const;
+    private:
+        const Options& _options;
+    };
+}
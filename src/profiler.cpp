@@ -0,0 +1,321 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+
+#include "debugtext.hpp"
+#include "glhelpers.hpp"
+
+namespace
+{
+    constexpr const char* passNames[raymarch::passCount] = {"uniforms", "prepass", "accumulation", "display"};
+
+    float toMilliseconds(const sf::Time time)
+    {
+        return static_cast<float>(time.asMicroseconds()) / 1000.0f;
+    }
+
+    std::string formatLine(const char* label, const float value, const char* unit)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%-12s %7.2f %s", label, value, unit);
+        return buffer;
+    }
+}
+
+void raymarch::RollingStatistic::push(const float value)
+{
+    _values[_next] = value;
+    _next = (_next + 1) % _capacity;
+    _count = std::min(_count + 1, _capacity);
+}
+
+float raymarch::RollingStatistic::getAverage() const
+{
+    if (_count == 0) return 0;
+    return std::accumulate(_values.begin(), _values.begin() + _count, 0.0f) / static_cast<float>(_count);
+}
+
+float raymarch::RollingStatistic::getMaximum() const
+{
+    if (_count == 0) return 0;
+    return *std::max_element(_values.begin(), _values.begin() + _count);
+}
+
+raymarch::Profiler::Profiler() :
+    _gpuTimers(gl::loadTimerQueries())
+{
+    if (!_gpuTimers)
+        std::cerr << "GL timer queries are not supported, only CPU times are profiled" << std::endl;
+}
+
+raymarch::Profiler::~Profiler()
+{
+    stopTrace();
+
+    if (!_gpuTimers) return;
+    for (const FrameRecord& frame : _frames)
+        for (const unsigned int query : frame.queries)
+            if (query != 0) gl::deleteQuery(query);
+}
+
+void raymarch::Profiler::beginFrame()
+{
+    const sf::Time frameStart = _frameClock.getElapsedTime();
+
+    // The slot of this frame still holds the frame issued _latency frames ago, its results are due
+    FrameRecord& frame = _frames[_frameId % _latency];
+    if (frame.pending)
+    {
+        resolve(frame, true);
+        _resolvedId = frame.id + 1;
+    }
+
+    frame.id = _frameId;
+    frame.pending = true;
+    frame.frameTime = _frameId > 0 ? toMilliseconds(frameStart - _previousFrameStart) : 0.0f;
+    frame.cpuTime = 0;
+    frame.passCpuTime.fill(0);
+    frame.passGpuTime.fill(0);
+    frame.queried.fill(false);
+
+    _previousFrameStart = frameStart;
+    _inFrame = true;
+}
+
+void raymarch::Profiler::endFrame()
+{
+    if (!_inFrame) return;
+
+    FrameRecord& frame = currentFrame();
+    frame.cpuTime = toMilliseconds(_frameClock.getElapsedTime() - _previousFrameStart);
+    _inFrame = false;
+    ++_frameId;
+
+    // Older frames are collected in order as soon as their queries are done
+    while (_resolvedId < _frameId)
+    {
+        FrameRecord& oldest = _frames[_resolvedId % _latency];
+        if (oldest.pending && !resolve(oldest, false)) break;
+        ++_resolvedId;
+    }
+}
+
+void raymarch::Profiler::begin(const Pass pass)
+{
+    if (!_inFrame) return;
+
+    const auto index = static_cast<std::size_t>(pass);
+    _passStart[index] = _passClock.getElapsedTime();
+
+    // A query object can only time one range, repeated passes in a frame are timed on the CPU only
+    FrameRecord& frame = currentFrame();
+    if (!_gpuTimers || frame.queried[index]) return;
+
+    if (frame.queries[index] == 0)
+        frame.queries[index] = gl::createQuery();
+    gl::beginTimeElapsed(frame.queries[index]);
+    frame.queried[index] = true;
+}
+
+void raymarch::Profiler::end(const Pass pass)
+{
+    if (!_inFrame) return;
+
+    const auto index = static_cast<std::size_t>(pass);
+    FrameRecord& frame = currentFrame();
+    frame.passCpuTime[index] += toMilliseconds(_passClock.getElapsedTime() - _passStart[index]);
+
+    if (_gpuTimers && frame.queried[index])
+        gl::endTimeElapsed();
+}
+
+void raymarch::Profiler::setAverageSteps(const float steps)
+{
+    _averageSteps = steps;
+}
+
+void raymarch::Profiler::setSampleCount(const std::uint32_t samples, const bool converged)
+{
+    _sampleCount = samples;
+    _converged = converged;
+}
+
+void raymarch::Profiler::setLatency(const float milliseconds)
+{
+    _motionLatency.push(milliseconds);
+}
+
+void raymarch::Profiler::toggleOverlay()
+{
+    _overlayVisible = !_overlayVisible;
+}
+
+bool raymarch::Profiler::isOverlayVisible() const
+{
+    return _overlayVisible;
+}
+
+void raymarch::Profiler::drawOverlay(sf::RenderTarget &target) const
+{
+    if (!_overlayVisible) return;
+
+    const float frameTime = _frameTime.getAverage();
+    std::vector<std::string> lines {
+        formatLine("FPS", frameTime > 0 ? 1000.0f / frameTime : 0.0f, ""),
+        formatLine("CPU", _cpuTime.getAverage(), "MS"),
+        _gpuTimers ? formatLine("GPU", _gpuTime.getAverage(), "MS") : "GPU              N/A",
+        formatLine("STEPS", _averageSteps, ""),
+        formatLine("SAMPLES", static_cast<float>(_sampleCount), _converged ? "DONE" : ""),
+        formatLine("LATENCY", _motionLatency.getAverage(), "MS")
+    };
+
+    for (std::size_t pass = 0; pass < passCount; ++pass)
+    {
+        const RollingStatistic& time = _gpuTimers ? _passGpuTime[pass] : _passCpuTime[pass];
+        lines.push_back(formatLine(passNames[pass], time.getAverage(), "MS"));
+    }
+
+    DebugText text;
+    text.setLines(lines);
+    text.draw(target, {8, 8});
+}
+
+bool raymarch::Profiler::startTrace(const std::filesystem::path &path)
+{
+    stopTrace();
+
+    _trace.open(path);
+    if (!_trace)
+    {
+        std::cerr << "Failed to open trace file " << path << std::endl;
+        return false;
+    }
+
+    _trace << "frame,frame_ms,cpu_ms,gpu_ms,avg_steps";
+    for (const char* name : passNames)
+        _trace << ',' << name << "_cpu_ms," << name << "_gpu_ms";
+    _trace << '\n';
+    return true;
+}
+
+void raymarch::Profiler::stopTrace()
+{
+    if (_trace.is_open())
+        _trace.close();
+}
+
+bool raymarch::Profiler::isTracing() const
+{
+    return _trace.is_open();
+}
+
+bool raymarch::Profiler::hasGpuTimers() const
+{
+    return _gpuTimers;
+}
+
+std::uint64_t raymarch::Profiler::getFrameId() const
+{
+    return _frameId;
+}
+
+bool raymarch::Profiler::isResolved(const std::uint64_t frameId) const
+{
+    return frameId < _resolvedId;
+}
+
+std::optional<float> raymarch::Profiler::getGpuTime(const std::uint64_t frameId, const Pass pass) const
+{
+    const FrameRecord& frame = _frames[frameId % _latency];
+    const auto index = static_cast<std::size_t>(pass);
+    if (!isResolved(frameId) || frame.id != frameId || frame.pending || !frame.queried[index]) return std::nullopt;
+    return frame.passGpuTime[index];
+}
+
+raymarch::Profiler::FrameRecord& raymarch::Profiler::currentFrame()
+{
+    return _frames[_frameId % _latency];
+}
+
+bool raymarch::Profiler::resolve(FrameRecord &frame, const bool wait)
+{
+    if (_gpuTimers)
+    {
+        for (std::size_t pass = 0; pass < passCount; ++pass)
+        {
+            if (!frame.queried[pass]) continue;
+            if (!wait && !gl::isQueryAvailable(frame.queries[pass])) return false;
+        }
+
+        for (std::size_t pass = 0; pass < passCount; ++pass)
+        {
+            if (frame.queried[pass])
+                frame.passGpuTime[pass] = static_cast<float>(gl::getQueryResult(frame.queries[pass])) / 1e6f;
+        }
+    }
+
+    frame.pending = false;
+
+    // The frame interval of the first frame is unknown
+    if (frame.id > 0)
+        _frameTime.push(frame.frameTime);
+    _cpuTime.push(frame.cpuTime);
+    _gpuTime.push(std::accumulate(frame.passGpuTime.begin(), frame.passGpuTime.end(), 0.0f));
+    for (std::size_t pass = 0; pass < passCount; ++pass)
+    {
+        _passCpuTime[pass].push(frame.passCpuTime[pass]);
+        _passGpuTime[pass].push(frame.passGpuTime[pass]);
+    }
+
+    if (_trace.is_open())
+        writeTraceRow(frame);
+    return true;
+}
+
+void raymarch::Profiler::writeTraceRow(const FrameRecord &frame)
+{
+    _trace << frame.id << ',' << frame.frameTime << ',' << frame.cpuTime << ','
+           << std::accumulate(frame.passGpuTime.begin(), frame.passGpuTime.end(), 0.0f) << ',' << _averageSteps;
+    for (std::size_t pass = 0; pass < passCount; ++pass)
+        _trace << ',' << frame.passCpuTime[pass] << ',' << frame.passGpuTime[pass];
+    _trace << '\n';
+}
+
+raymarch::PassTimeQueue::PassTimeQueue(const Pass pass) :
+    _pass(pass)
+{
+}
+
+void raymarch::PassTimeQueue::push(const Profiler &profiler, const float work)
+{
+    _pending.push_back({profiler.getFrameId(), work});
+}
+
+std::optional<raymarch::PassTimeQueue::Timing> raymarch::PassTimeQueue::poll(const Profiler &profiler)
+{
+    // Frames resolve in order, the first one still in flight ends the search
+    while (!_pending.empty() && profiler.isResolved(_pending.front().frameId))
+    {
+        const Entry entry = _pending.front();
+        _pending.pop_front();
+
+        if (const std::optional<float> milliseconds = profiler.getGpuTime(entry.frameId, _pass))
+            return Timing {entry.work, *milliseconds};
+    }
+    return std::nullopt;
+}
+
+raymarch::ProfileScope::ProfileScope(Profiler* profiler, const Pass pass) :
+    _profiler(profiler),
+    _pass(pass)
+{
+    if (_profiler) _profiler->begin(_pass);
+}
+
+raymarch::ProfileScope::~ProfileScope()
+{
+    if (_profiler) _profiler->end(_pass);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Sections of a frame that are timed separately, in the order they are issued
+    enum class Pass
+    {
+        Uniforms,
+        Prepass,
+        Accumulation,
+        Display
+    };
+
+    inline constexpr std::size_t passCount = 4;
+
+    // Average and maximum over the last samples
+    class RollingStatistic
+    {
+    public:
+        void push(float value);
+
+        [[nodiscard]] float getAverage() const;
+        [[nodiscard]] float getMaximum() const;
+    private:
+        static constexpr std::size_t _capacity = 120;
+
+        std::array<float, _capacity> _values {};
+        std::size_t _count = 0;
+        std::size_t _next = 0;
+    };
+
+    // CPU clocks and GL timer queries around the passes of a frame, read back a few frames later to avoid stalls
+    class Profiler
+    {
+    public:
+        Profiler();
+        ~Profiler();
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        void beginFrame();
+        void endFrame();
+        void begin(Pass pass);
+        void end(Pass pass);
+        void setAverageSteps(float steps);
+        void setSampleCount(std::uint32_t samples, bool converged);
+        void setLatency(float milliseconds);
+
+        void toggleOverlay();
+        [[nodiscard]] bool isOverlayVisible() const;
+        void drawOverlay(sf::RenderTarget &target) const;
+
+        bool startTrace(const std::filesystem::path &path);
+        void stopTrace();
+        [[nodiscard]] bool isTracing() const;
+        [[nodiscard]] bool hasGpuTimers() const;
+
+        // Frame being recorded, its GPU times are known once a later frame has resolved it
+        [[nodiscard]] std::uint64_t getFrameId() const;
+        [[nodiscard]] bool isResolved(std::uint64_t frameId) const;
+
+        // GPU time of a pass in a resolved frame, empty if it was not queried or its record has been reused
+        [[nodiscard]] std::optional<float> getGpuTime(std::uint64_t frameId, Pass pass) const;
+    private:
+        // Everything measured during one frame, kept until its queries have results
+        struct FrameRecord
+        {
+            std::uint64_t id = 0;
+            bool pending = false;
+            float frameTime = 0;
+            float cpuTime = 0;
+            std::array<float, passCount> passCpuTime {};
+            std::array<float, passCount> passGpuTime {};
+            std::array<unsigned int, passCount> queries {};
+            std::array<bool, passCount> queried {};
+        };
+
+        // Frames of queries in flight before a result is waited for
+        static constexpr std::size_t _latency = 4;
+
+        bool _gpuTimers;
+        bool _overlayVisible = false;
+
+        std::array<FrameRecord, _latency> _frames;
+        std::uint64_t _frameId = 0;
+        std::uint64_t _resolvedId = 0;
+
+        sf::Clock _frameClock;
+        sf::Clock _passClock;
+        std::array<sf::Time, passCount> _passStart {};
+        sf::Time _previousFrameStart;
+        bool _inFrame = false;
+
+        RollingStatistic _frameTime;
+        RollingStatistic _cpuTime;
+        RollingStatistic _gpuTime;
+        std::array<RollingStatistic, passCount> _passCpuTime;
+        std::array<RollingStatistic, passCount> _passGpuTime;
+        RollingStatistic _motionLatency;
+        float _averageSteps = 0;
+        std::uint32_t _sampleCount = 0;
+        bool _converged = false;
+
+        std::ofstream _trace;
+
+        [[nodiscard]] FrameRecord& currentFrame();
+        bool resolve(FrameRecord &frame, bool wait);
+        void writeTraceRow(const FrameRecord &frame);
+    };
+
+    // Work issued in a frame, matched with the GPU time of one of its passes once the profiler has the result
+    class PassTimeQueue
+    {
+    public:
+        struct Timing
+        {
+            float work;
+            float milliseconds;
+        };
+
+        explicit PassTimeQueue(Pass pass);
+
+        // Work of the current frame, the pass should be timed by exactly this work
+        void push(const Profiler &profiler, float work);
+
+        // Oldest frame with a result, frames whose result is lost are dropped on the way
+        [[nodiscard]] std::optional<Timing> poll(const Profiler &profiler);
+    private:
+        struct Entry
+        {
+            std::uint64_t frameId;
+            float work;
+        };
+
+        Pass _pass;
+        std::deque<Entry> _pending;
+    };
+
+    // Times a pass for as long as it is in scope, a null profiler records nothing
+    class ProfileScope
+    {
+    public:
+        ProfileScope(Profiler* profiler, Pass pass);
+        ~ProfileScope();
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    private:
+        Profiler* _profiler;
+        Pass _pass;
+    };
+}
@@ -59,6 +59,12 @@ raymarch::Quaternion raymarch::Quaternion::negative() const
     return {-this->x, -this->y, -this->z, -this->w};
 }
 
+std::array<float, 4> raymarch::Quaternion::toArray() const
+{
+    // x, y, z, w, the order of the constructor
+    return {this->x, this->y, this->z, this->w};
+}
+
 raymarch::Quaternion raymarch::Quaternion::conjugate() const
 {
     return { -this->x, -this->y, -this->z, this->w };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <SFML/Graphics.hpp>
 
 namespace raymarch
@@ -14,6 +15,7 @@ namespace raymarch
         [[nodiscard]] Quaternion normalize() const;
         [[nodiscard]] Quaternion conjugate() const;
         [[nodiscard]] Quaternion negative() const;
+        [[nodiscard]] std::array<float, 4> toArray() const;
 
         Quaternion operator*(const Quaternion& q) const;
         Quaternion operator*(float f) const;
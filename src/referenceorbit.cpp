@@ -0,0 +1,120 @@
+#include "referenceorbit.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    using Vector3d = sf::Vector3<double>;
+
+    // Constants of mandelboxDE in estimators.glsl
+    constexpr double minRadius2 = 0.5;
+    constexpr double fixedRadius2 = 1.0;
+    constexpr double escapeRadius2 = 10000.0;
+
+    double boxFold(const double x, const double limit)
+    {
+        return std::clamp(x, -limit, limit) * 2.0 - x;
+    }
+
+    // One iteration of mandelboxDE, the point and the running derivative
+    void iterate(Vector3d &z, double &dr, const Vector3d &c, const raymarch::FractalParameters &parameters)
+    {
+        const double limit = parameters.boxFoldLimit;
+        z = {boxFold(z.x, limit), boxFold(z.y, limit), boxFold(z.z, limit)};
+
+        const double r2 = z.lengthSquared();
+        const double scale = r2 < minRadius2 ? fixedRadius2 / minRadius2 : r2 < fixedRadius2 ? fixedRadius2 / r2 : 1.0;
+        z *= scale;
+        dr *= scale;
+
+        z = z * static_cast<double>(parameters.boxScale) + c;
+        dr = dr * std::abs(static_cast<double>(parameters.boxScale)) + 1.0;
+    }
+
+    double estimate(const Vector3d &p, const raymarch::FractalParameters &parameters)
+    {
+        Vector3d z = p;
+        double dr = 1.0;
+        for (std::size_t i = 0; i < raymarch::ReferenceOrbit::iterations; ++i)
+        {
+            iterate(z, dr, p, parameters);
+            if (z.lengthSquared() > escapeRadius2) break;
+        }
+        return z.length() / std::abs(dr);
+    }
+}
+
+bool raymarch::ReferenceOrbit::update(const Camera &camera, const FractalParameters &parameters)
+{
+    const Vector3d origin = camera.getOrigin();
+    const float detailScale = camera.getDetailScale();
+    if (isValid() && origin == _origin && camera.forward == _direction && detailScale == _detailScale && parameters == _parameters)
+        return false;
+
+    _origin = origin;
+    _direction = camera.forward;
+    _detailScale = detailScale;
+    _parameters = parameters;
+
+    // The surface point of the centre ray, the pixels around it stay close to its orbit. A miss keeps the camera origin
+    const Vector3d direction(camera.forward);
+    const double epsilon = static_cast<double>(parameters.epsilon) * detailScale;
+    double distance = 0;
+    _point = origin;
+    for (int i = 0; i < parameters.iterations && distance < parameters.maxDistance; ++i)
+    {
+        const Vector3d p = origin + direction * distance;
+        const double d = estimate(p, parameters);
+        if (d < epsilon)
+        {
+            _point = p;
+            break;
+        }
+        distance += d;
+    }
+
+    // Rounded to float only once iterated, the shader adds its offsets to these values
+    Vector3d z = _point;
+    double dr = 1.0;
+    _orbit.fill({});
+    _orbit[0] = sf::Vector3f(z);
+    _length = static_cast<int>(iterations);
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        iterate(z, dr, _point, parameters);
+        _orbit[i + 1] = sf::Vector3f(z);
+        if (z.lengthSquared() > escapeRadius2)
+        {
+            _length = static_cast<int>(i + 1);
+            break;
+        }
+    }
+    return true;
+}
+
+void raymarch::ReferenceOrbit::clear()
+{
+    _point = {};
+    _length = 0;
+}
+
+bool raymarch::ReferenceOrbit::isValid() const
+{
+    return _length > 0;
+}
+
+const sf::Vector3<double>& raymarch::ReferenceOrbit::getPoint() const
+{
+    return _point;
+}
+
+const std::array<sf::Glsl::Vec3, raymarch::ReferenceOrbit::iterations + 1>& raymarch::ReferenceOrbit::getOrbit() const
+{
+    return _orbit;
+}
+
+int raymarch::ReferenceOrbit::getLength() const
+{
+    return _length;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <SFML/Graphics.hpp>
+
+#include "camera.hpp"
+#include "parameters.hpp"
+
+namespace raymarch
+{
+    // Mandelbox orbit of one point in double precision, deep zoom iterates every pixel as a float offset from it
+    class ReferenceOrbit
+    {
+    public:
+        // Iterations of mandelboxDE, the orbit holds the point before each of them and after the last
+        static constexpr std::size_t iterations = 20;
+
+        // Marches the centre ray in double precision and iterates the point it hits, false if nothing changed
+        bool update(const Camera &camera, const FractalParameters &parameters);
+        void clear();
+
+        [[nodiscard]] bool isValid() const;
+        [[nodiscard]] const sf::Vector3<double>& getPoint() const;
+        [[nodiscard]] const std::array<sf::Glsl::Vec3, iterations + 1>& getOrbit() const;
+
+        // Iterations before the reference escapes, the shader continues in plain float after them
+        [[nodiscard]] int getLength() const;
+    private:
+        sf::Vector3<double> _point;
+        std::array<sf::Glsl::Vec3, iterations + 1> _orbit {};
+        int _length = 0;
+
+        // View and fractal the orbit was computed for
+        sf::Vector3<double> _origin;
+        sf::Vector3f _direction;
+        float _detailScale = 0;
+        FractalParameters _parameters;
+    };
+}
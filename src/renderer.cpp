@@ -0,0 +1,1081 @@
+#include "renderer.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <SFML/OpenGL.hpp>
+
+#include "config.hpp"
+#include "glhelpers.hpp"
+#include "helpers.hpp"
+
+namespace
+{
+    constexpr float coneDivisors[2] = {8.0f, 4.0f};
+
+    // Everything the cone pre-pass depends on, the start distances are reused while it stays the same
+    std::array<float, 20> makeConeKey(const raymarch::Camera &camera, const sf::Vector2f &targetSize)
+    {
+        // The double origin as a float and the float remainder, so sub-float moves change the key too
+        const sf::Glsl::Vec3 position = camera.getPosition();
+        const sf::Glsl::Vec3 positionLow(camera.getOrigin() - sf::Vector3<double>(position));
+        const sf::Glsl::Mat3 rotation = camera.getRotationMatrix();
+
+        std::array<float, 20> key {};
+        key[0] = position.x;
+        key[1] = position.y;
+        key[2] = position.z;
+        std::copy_n(rotation.array, 9, key.begin() + 3);
+        key[12] = camera.getFOV();
+        key[13] = camera.getAperture();
+        key[14] = camera.getFocusDistance();
+        key[15] = targetSize.x * 65536.0f + targetSize.y;
+        key[16] = positionLow.x;
+        key[17] = positionLow.y;
+        key[18] = positionLow.z;
+        key[19] = camera.getDetailScale();
+        return key;
+    }
+
+    std::uint64_t sumCounts(const sf::Image &image)
+    {
+        const std::size_t pixelCount = static_cast<std::size_t>(image.getSize().x) * image.getSize().y;
+        const std::uint8_t* pixels = image.getPixelsPtr();
+
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < pixelCount; ++i)
+            total += static_cast<std::uint64_t>(pixels[i * 4]) * 256 + pixels[i * 4 + 1];
+        return total;
+    }
+}
+
+raymarch::ViewState raymarch::ViewState::fromCamera(const Camera &camera)
+{
+    ViewState view;
+    view.position = camera.getOrigin();
+    std::copy_n(camera.getRotationMatrix().array, 9, view.rotation.begin());
+    view.fov = camera.getFOV();
+    view.aperture = camera.getAperture();
+    view.focusDistance = camera.getFocusDistance();
+    return view;
+}
+
+bool raymarch::ViewState::operator==(const ViewState &other) const
+{
+    return position == other.position && rotation == other.rotation && fov == other.fov &&
+           aperture == other.aperture && focusDistance == other.focusDistance;
+}
+
+bool raymarch::ViewState::operator!=(const ViewState &other) const
+{
+    return !(*this == other);
+}
+
+std::uint64_t raymarch::StepCount::total() const
+{
+    return prepass + shading;
+}
+
+raymarch::Renderer::Renderer(const sf::Vector2u &resolution) :
+    _resolution(resolution),
+    _resolutionF(static_cast<sf::Vector2f>(resolution)),
+    _fullScreenQuad(_resolutionF),
+    _accumulation{sf::RenderTexture(resolution), sf::RenderTexture(resolution)},
+    _variants(config::shaderCacheDirectory),
+    _tiles(resolution, config::tileSize),
+    _conePrepass(config::conePrepass),
+    _distanceVolume(config::distanceVolume)
+{
+    _fullScreenQuad.setFillColor(sf::Color::Red);
+    initAccumulation();
+}
+
+bool raymarch::Renderer::loadShader(const std::filesystem::path &path)
+{
+    _shader = nullptr;
+    _shaderPath = path;
+    _uniformBuffers = gl::supportsUniformBuffers();
+    if (!_variants.loadSource(path) || !selectShaderVariant())
+    {
+        std::cerr << "Failed to load fragment shader" << std::endl;
+        return false;
+    }
+
+    // The heatmap shader lives next to the main one, diagnostics are optional
+    _heatmapAvailable = _heatmapShader.loadFromFile(path.parent_path() / "heatmap.frag", sf::Shader::Type::Fragment);
+    if (!_heatmapAvailable)
+        std::cerr << "Failed to load heatmap shader, diagnostics are disabled" << std::endl;
+    _heatmapShader.setUniform("counters", sf::Shader::CurrentTexture);
+
+    // Without the reduction shader accumulation runs to the sample limit
+    _convergence.loadShader(path.parent_path() / "convergence.frag");
+
+    // Without the baking shader the lighting rays use the exact estimator
+    if (_volume.loadShader(path.parent_path() / "volume.frag"))
+        bakeDistanceVolume();
+
+    return true;
+}
+
+void raymarch::Renderer::setHotReload(const bool enabled)
+{
+    if (!enabled || _shaderPath.empty())
+    {
+        _reloader.reset();
+        return;
+    }
+
+    _reloader = std::make_unique<ShaderReloader>(_shaderPath, config::shaderCacheDirectory);
+    _reloader->setVariants(_variants.getCompiledDefines());
+}
+
+bool raymarch::Renderer::applyShaderReload()
+{
+    if (!_reloader) return false;
+
+    std::unique_ptr<ShaderVariantCache> reloaded = _reloader->takeReloaded();
+    if (!reloaded) return false;
+
+    // Swapping the whole cache, the selected variant gets every uniform again
+    _variants = std::move(*reloaded);
+    _shader = nullptr;
+    if (!selectShaderVariant())
+    {
+        std::cerr << "Reloaded shader has no usable variant" << std::endl;
+        return false;
+    }
+
+    // The estimator may have changed, so the start distances, the volume and the history are stale
+    _coneKey.reset();
+    _historyValid = false;
+    if (_volume.loadShader(_shaderPath.parent_path() / "volume.frag"))
+        bakeDistanceVolume();
+    std::cout << "Shader reloaded" << std::endl;
+    return true;
+}
+
+void raymarch::Renderer::resize(const sf::Vector2u &resolution)
+{
+    _resolution = resolution;
+    _resolutionF = static_cast<sf::Vector2f>(resolution);
+
+    // Updating FSQ size
+    _fullScreenQuad.setSize(_resolutionF);
+
+    // Recreating the accumulation buffers, history is lost anyway
+    _historyValid = false;
+    _scaledOutput = false;
+    _coneKey.reset();
+    _tiles.resize(resolution);
+    for (sf::RenderTexture& target : _accumulation)
+    {
+        if (!target.resize(resolution))
+            std::cerr << "Failed to resize accumulation texture" << std::endl;
+    }
+    initAccumulation();
+
+    // Updating shader uniform
+    if (_shader)
+        _uniforms.set("iResolution", _resolutionF);
+}
+
+void raymarch::Renderer::seed(const unsigned int seed)
+{
+    _sampler.seed(seed);
+    if (_shader)
+        _sampler.apply(_uniforms);
+}
+
+void raymarch::Renderer::setParameters(const FractalParameters &parameters)
+{
+    _parameters = parameters;
+    _historyValid = false;
+    if (!_shader) return;
+
+    // A newly selected variant gets every uniform, the current one only the parameters
+    const sf::Shader* previous = _shader;
+    selectShaderVariant();
+    if (_shader == previous)
+        setParameterUniforms();
+    bakeDistanceVolume();
+}
+
+void raymarch::Renderer::render(const Camera &camera, const float iTime, const bool accumulate)
+{
+    // A converged history of this view is final, the GPU has nothing left to do
+    const ViewState view = ViewState::fromCamera(camera);
+    if (accumulate && isFinal(camera))
+    {
+        _scaledOutput = false;
+        return;
+    }
+
+    // Updating shader uniforms related to the camera
+    {
+        const ProfileScope scope(_profiler, Pass::Uniforms);
+        updateCamera(camera, iTime);
+    }
+
+    // Ping-pong buffers
+    const int readIndex = _pingpong;
+    const int writeIndex = 1 - _pingpong;
+
+    // Set last frame for temporal blending
+    _uniforms.set("lastFrame", _accumulation[readIndex].getTexture());
+
+    // History is reprojected from the camera that rendered it, a still camera reads it in place
+    const bool reproject = _reprojection && _historyValid && view != _historyView;
+    _uniforms.set("reproject", reproject);
+    if (reproject)
+    {
+        _uniforms.set("prevCamPosition", sf::Vector3f(_historyView.position - _reference.getPoint()));
+        _uniforms.set("prevCamRotationMatrix", sf::Glsl::Mat3(_historyView.rotation.data()));
+        _uniforms.set("prevFov", _historyView.fov);
+    }
+
+    prepareConeDistance(camera, _resolutionF);
+
+    // The first full resolution frame after scaled ones starts a fresh history
+    const bool accumulatePass = accumulate && _historyValid;
+    _scaledOutput = false;
+
+    // Motion frames are marched whole, a progressive pass would start over with every view and never complete
+    const bool moving = view != _historyView;
+    if (moving && _tiles.isPassStarted())
+        _tiles.startPass();
+
+    // History of another view that is not reprojected holds no samples of this one
+    if (!reproject && view != _historyView && !_tiles.isPassStarted())
+    {
+        _sampleCount = 0;
+        _sampleIndex = 0;
+    }
+
+    // Exact running mean while still, an exponential average of the reprojected history while moving
+    const float blend = reproject ? config::reprojectionBlend
+                                  : static_cast<float>(_sampleCount) / static_cast<float>(_sampleCount + 1);
+    _uniforms.set("blendFactor", blend);
+
+    // Once tiles have converged only the noisy ones are marched
+    const bool adaptive = _convergedTiles > 0 && accumulatePass && !reproject;
+
+    if (!_tiles.isEnabled() || moving)
+    {
+        {
+            const ProfileScope scope(_profiler, Pass::Accumulation);
+            if (adaptive)
+            {
+                _passSampleIndex = _sampleIndex++;
+                setPassUniforms(_resolutionF, accumulatePass);
+                appendAdaptiveTiles({{0, 0}, static_cast<sf::Vector2i>(_resolution)});
+
+                _uniforms.flush();
+                drawAdaptiveTiles(_accumulation[writeIndex], _accumulation[readIndex].getTexture());
+                _accumulation[writeIndex].display();
+            }
+            else
+            {
+                drawPass(_accumulation[writeIndex], accumulatePass);
+            }
+        }
+        completePass(view, reproject, accumulatePass);
+        return;
+    }
+
+    // Progressive pass, only the tiles that fit the frame budget are marched
+    if (!_tiles.isPassStarted())
+        _passSampleIndex = _sampleIndex++;
+    setPassUniforms(_resolutionF, accumulatePass);
+    _uniforms.flush();
+
+    sf::RenderTexture& target = _accumulation[writeIndex];
+    bindPassTextures(target);
+    const unsigned int firstTile = _tiles.getNextTile();
+    const unsigned int tileCount = _tiles.getTileBudget();
+
+    // Costs of tiles drawn a few frames ago
+    const bool timerQueries = _profiler && _profiler->hasGpuTimers();
+    if (timerQueries)
+    {
+        while (const std::optional<PassTimeQueue::Timing> timing = _tileTimes.poll(*_profiler))
+            _tiles.addCost(static_cast<unsigned int>(timing->work), timing->milliseconds);
+    }
+
+    const ProfileScope scope(_profiler, Pass::Accumulation);
+    _tileClock.restart();
+    for (unsigned int tile = firstTile; tile < firstTile + tileCount; ++tile)
+    {
+        const sf::IntRect area = _tiles.getTile(tile);
+        if (adaptive)
+        {
+            appendAdaptiveTiles(area);
+            continue;
+        }
+
+        _fullScreenQuad.setPosition(static_cast<sf::Vector2f>(area.position));
+        _fullScreenQuad.setSize(static_cast<sf::Vector2f>(area.size));
+        target.draw(_fullScreenQuad, getPassStates());
+    }
+    if (adaptive)
+        drawAdaptiveTiles(target, _accumulation[readIndex].getTexture());
+    target.display();
+    _fullScreenQuad.setPosition({0, 0});
+
+    // Without timer queries the tile cost is only known once the GPU is done
+    if (timerQueries)
+    {
+        _tileTimes.push(*_profiler, static_cast<float>(tileCount));
+    }
+    else
+    {
+        if (target.setActive(true))
+            glFinish();
+        _tiles.addCost(tileCount, static_cast<float>(_tileClock.getElapsedTime().asMicroseconds()) / 1000.0f);
+    }
+    _tiles.advance(tileCount);
+
+    if (_tiles.isPassComplete())
+    {
+        _tiles.startPass();
+        completePass(view, reproject, accumulatePass);
+    }
+}
+
+void raymarch::Renderer::renderScaled(const Camera &camera, const float iTime, const float renderScale)
+{
+    // Updating shader uniforms related to the camera
+    {
+        const ProfileScope scope(_profiler, Pass::Uniforms);
+        updateCamera(camera, iTime);
+    }
+
+    // Whole frame at reduced resolution while the camera moves, the history is neither read nor written
+    const sf::Vector2u scaledResolution {
+        std::max(1u, static_cast<unsigned int>(std::lround(_resolutionF.x * renderScale))),
+        std::max(1u, static_cast<unsigned int>(std::lround(_resolutionF.y * renderScale)))
+    };
+
+    if (_scaledTarget.getSize() != scaledResolution)
+    {
+        if (!_scaledTarget.resize(scaledResolution))
+            std::cerr << "Failed to resize scaled render texture" << std::endl;
+        _scaledTarget.setSmooth(true);
+    }
+
+    prepareConeDistance(camera, static_cast<sf::Vector2f>(scaledResolution));
+    _uniforms.set("reproject", false);
+    {
+        const ProfileScope scope(_profiler, Pass::Accumulation);
+        drawPass(_scaledTarget, false);
+    }
+    _scaledOutput = true;
+    _historyValid = false;
+    _sampleCount = 0;
+    _sampleIndex = 0;
+    resetConvergence();
+    _tiles.startPass();
+}
+
+void raymarch::Renderer::draw(sf::RenderTarget &target) const
+{
+    const ProfileScope scope(_profiler, Pass::Display);
+    const sf::Vector2f targetSize = static_cast<sf::Vector2f>(target.getSize());
+
+    if (_heatmap != HeatmapChannel::None)
+    {
+        sf::Sprite heatmapSprite(_diagnostics.getTexture());
+        heatmapSprite.setScale(targetSize.componentWiseDiv(static_cast<sf::Vector2f>(_diagnostics.getSize())));
+
+        sf::RenderStates states(&_heatmapShader);
+        states.blendMode = sf::BlendNone;
+        target.draw(heatmapSprite, states);
+        return;
+    }
+
+    if (_scaledOutput)
+    {
+        sf::Sprite scaledSprite(_scaledTarget.getTexture());
+        scaledSprite.setScale(targetSize.componentWiseDiv(static_cast<sf::Vector2f>(_scaledTarget.getSize())));
+        target.draw(scaledSprite, sf::BlendNone);
+        return;
+    }
+
+    // Last completed pass
+    const sf::Vector2f scale = targetSize.componentWiseDiv(_resolutionF);
+    sf::Sprite displaySprite(_accumulation[_pingpong].getTexture());
+    displaySprite.setScale(scale);
+
+    // Alpha holds the depth, not coverage
+    target.draw(displaySprite, sf::BlendNone);
+
+    if (!_tiles.isPassStarted()) return;
+
+    // Overlaying the tiles of the pass in progress
+    for (const sf::IntRect& area : _tiles.getCompletedArea())
+    {
+        if (area.size.x <= 0 || area.size.y <= 0) continue;
+
+        sf::Sprite tileSprite(_accumulation[1 - _pingpong].getTexture(), area);
+        tileSprite.setPosition(static_cast<sf::Vector2f>(area.position).componentWiseMul(scale));
+        tileSprite.setScale(scale);
+        target.draw(tileSprite, sf::BlendNone);
+    }
+}
+
+void raymarch::Renderer::setReprojection(const bool enabled)
+{
+    // Depth in the history alpha needs float textures
+    _reprojection = enabled && _floatHistory;
+}
+
+void raymarch::Renderer::setConvergence(const bool enabled)
+{
+    _convergenceEnabled = enabled;
+    resetConvergence();
+}
+
+bool raymarch::Renderer::isReprojecting() const
+{
+    return _reprojection;
+}
+
+bool raymarch::Renderer::isConverged() const
+{
+    return _converged;
+}
+
+bool raymarch::Renderer::isFinal(const Camera &camera) const
+{
+    return _converged && _historyValid && ViewState::fromCamera(camera) == _historyView && !_tiles.isPassStarted();
+}
+
+std::uint32_t raymarch::Renderer::getSampleCount() const
+{
+    return _sampleCount;
+}
+
+void raymarch::Renderer::setProfiler(Profiler* profiler)
+{
+    _profiler = profiler;
+}
+
+void raymarch::Renderer::setDistanceVolume(const bool enabled)
+{
+    _distanceVolume = enabled;
+    _historyValid = false;
+    if (_shader)
+        bakeDistanceVolume();
+}
+
+void raymarch::Renderer::setConePrepass(const bool enabled)
+{
+    _conePrepass = enabled;
+    _coneKey.reset();
+    if (_shader)
+        _uniforms.set("useConeDistance", false);
+}
+
+raymarch::StepCount raymarch::Renderer::countSteps(const Camera &camera, const float iTime)
+{
+    updateCamera(camera, iTime);
+
+    StepCount count;
+    count.pixels = static_cast<std::uint64_t>(_resolution.x) * _resolution.y;
+
+    // Every cone level is drawn twice: once to count, once for the distances the next level reads
+    if (_conePrepass)
+    {
+        for (int level = 0; level < 2; ++level)
+        {
+            _uniforms.set("outputSteps", true);
+            drawConeLevel(level, _resolutionF);
+            count.prepass += sumCounts(_conePass[level].getTexture().copyToImage());
+
+            _uniforms.set("outputSteps", false);
+            drawConeLevel(level, _resolutionF);
+        }
+
+        _coneKey.reset();
+        _uniforms.set("useConeDistance", true);
+        bindConeLevel(1, coneDivisors[1]);
+    }
+
+    sf::RenderTexture counts {_resolution};
+    _uniforms.set("outputSteps", true);
+
+    setPassUniforms(_resolutionF, false);
+    _fullScreenQuad.setSize(_resolutionF);
+
+    _uniforms.flush();
+    bindPassTextures(counts);
+    counts.clear();
+    counts.draw(_fullScreenQuad, getPassStates());
+    counts.display();
+    count.shading = sumCounts(counts.getTexture().copyToImage());
+
+    _uniforms.set("outputSteps", false);
+    return count;
+}
+
+std::vector<float> raymarch::Renderer::renderRegion(const Camera &camera, const sf::Vector2u &imageSize, const sf::IntRect &region, const uint32_t samples)
+{
+    const sf::Vector2u regionSize = static_cast<sf::Vector2u>(region.size);
+    const sf::Vector2f regionSizeF = static_cast<sf::Vector2f>(region.size);
+    const sf::Vector2f imageSizeF = static_cast<sf::Vector2f>(imageSize);
+
+    // The running mean needs more precision than 8 bits
+    for (sf::RenderTexture& target : _region)
+    {
+        if (target.getSize() == regionSize) continue;
+        if (!target.resize(regionSize) || !gl::makeFloatTarget(target))
+        {
+            std::cerr << "Region renders need a float render target" << std::endl;
+            return {};
+        }
+    }
+
+    // Regions are given top-down, gl_FragCoord counts from the bottom of the image
+    const sf::Vector2f tileOrigin {
+        static_cast<float>(region.position.x),
+        static_cast<float>(static_cast<int>(imageSize.y) - region.position.y - region.size.y)
+    };
+
+    // Every sample marches from the camera, neither the cone distances nor the interactive history apply
+    // A progressive pass in flight keeps its sample index
+    const std::uint32_t passSampleIndex = _passSampleIndex;
+    _uniforms.set("reproject", false);
+    _uniforms.set("useConeDistance", false);
+    _uniforms.set("tileOrigin", tileOrigin);
+    _fullScreenQuad.setSize(regionSizeF);
+
+    int readIndex = 0;
+    for (uint32_t sample = 0; sample < samples; ++sample)
+    {
+        // The sample index varies the lens position of the depth of field
+        updateCamera(camera, static_cast<float>(sample));
+
+        // Samples are indexed by image pixel, so tiles continue each other's blue noise without seams
+        _passSampleIndex = sample;
+        setPassUniforms(imageSizeF, true);
+        _uniforms.set("historySize", regionSizeF);
+
+        // Exact running mean, the first sample ignores the cleared history
+        _uniforms.set("blendFactor", static_cast<float>(sample) / static_cast<float>(sample + 1));
+        _uniforms.set("lastFrame", _region[readIndex].getTexture());
+
+        sf::RenderTexture& target = _region[1 - readIndex];
+        _uniforms.flush();
+        bindPassTextures(target);
+        target.clear();
+        target.draw(_fullScreenQuad, getPassStates());
+        target.display();
+
+        readIndex = 1 - readIndex;
+    }
+
+    // Restoring the interactive state
+    _passSampleIndex = passSampleIndex;
+    _coneKey.reset();
+    _uniforms.set("tileOrigin", sf::Vector2f(0, 0));
+    _uniforms.set("lastFrame", _accumulation[_pingpong].getTexture());
+    setPassUniforms(_resolutionF, true);
+    _fullScreenQuad.setSize(_resolutionF);
+
+    return gl::readFloatTarget(_region[readIndex]);
+}
+
+void raymarch::Renderer::setHeatmap(const HeatmapChannel channel)
+{
+    _heatmap = _heatmapAvailable ? channel : HeatmapChannel::None;
+    if (_heatmap == HeatmapChannel::None) return;
+
+    _heatmapShader.setUniform("channel", static_cast<int>(_heatmap));
+    _heatmapShader.setUniform("maxValue", getHeatmapRange(_heatmap));
+}
+
+raymarch::HeatmapChannel raymarch::Renderer::getHeatmap() const
+{
+    return _heatmap;
+}
+
+bool raymarch::Renderer::renderDiagnostics(const Camera &camera, const float iTime)
+{
+    if (drawFloatPass(camera, iTime, 2)) return true;
+
+    _heatmap = HeatmapChannel::None;
+    return false;
+}
+
+std::vector<float> raymarch::Renderer::renderNormals(const Camera &camera)
+{
+    if (!drawFloatPass(camera, 0, 3)) return {};
+    return gl::readFloatTarget(_diagnostics);
+}
+
+bool raymarch::Renderer::drawFloatPass(const Camera &camera, const float iTime, const int passMode)
+{
+    {
+        const ProfileScope scope(_profiler, Pass::Uniforms);
+        updateCamera(camera, iTime);
+    }
+
+    // Counters exceed 1.0 and normals are signed, an 8-bit target would clamp them
+    if (_diagnostics.getSize() != _resolution)
+    {
+        if (!_diagnostics.resize(_resolution) || !gl::makeFloatTarget(_diagnostics))
+        {
+            std::cerr << "Diagnostics need a float render target" << std::endl;
+            return false;
+        }
+    }
+
+    prepareConeDistance(camera, _resolutionF);
+
+    // Unjittered, the outputs describe the pixel centres
+    setPassUniforms(_resolutionF, false);
+    _fullScreenQuad.setSize(_resolutionF);
+    _uniforms.set("passMode", passMode);
+
+    {
+        const ProfileScope scope(_profiler, Pass::Accumulation);
+        _uniforms.flush();
+        bindPassTextures(_diagnostics);
+        _diagnostics.clear();
+        _diagnostics.draw(_fullScreenQuad, getPassStates());
+        _diagnostics.display();
+    }
+
+    _uniforms.set("passMode", 0);
+    return true;
+}
+
+std::vector<float> raymarch::Renderer::readDiagnostics()
+{
+    return gl::readFloatTarget(_diagnostics);
+}
+
+void raymarch::Renderer::setFrameBudget(const float milliseconds)
+{
+    _tiles.setBudget(milliseconds);
+    _tiles.startPass();
+}
+
+void raymarch::Renderer::finish()
+{
+    // Blocking until the GPU has executed every queued command
+    if (getTarget().setActive(true))
+        glFinish();
+}
+
+void raymarch::Renderer::drawPass(sf::RenderTexture &target, const bool accumulate)
+{
+    const sf::Vector2f targetSize = static_cast<sf::Vector2f>(target.getSize());
+
+    _passSampleIndex = _sampleIndex++;
+    setPassUniforms(targetSize, accumulate);
+    _fullScreenQuad.setSize(targetSize);
+
+    // Render to write buffer
+    _uniforms.flush();
+    bindPassTextures(target);
+    target.clear();
+    target.draw(_fullScreenQuad, getPassStates());
+    target.display();
+}
+
+void raymarch::Renderer::completePass(const ViewState &view, const bool reprojected, const bool accumulated)
+{
+    // Reprojected history counts as many samples as the exponential average weighs it
+    if (reprojected)
+    {
+        _sampleCount = static_cast<std::uint32_t>(std::lround(config::reprojectionBlend / (1.0f - config::reprojectionBlend)));
+        resetConvergence();
+    }
+    else if (!accumulated || _sampleCount == 0)
+    {
+        _sampleCount = 1;
+        resetConvergence();
+    }
+    else
+    {
+        ++_sampleCount;
+    }
+
+    _historyValid = true;
+    _historyView = view;
+
+    // Swap
+    _pingpong = 1 - _pingpong;
+    updateConvergence();
+}
+
+void raymarch::Renderer::resetConvergence()
+{
+    _converged = false;
+    _nextConvergenceCheck = config::convergenceFirstCheck;
+    _convergence.reset(_resolution, config::adaptiveTileSize);
+
+    const unsigned int tileSize = config::adaptiveTileSize;
+    _adaptiveGrid = {(_resolution.x + tileSize - 1) / tileSize, (_resolution.y + tileSize - 1) / tileSize};
+    _activeTiles.assign(static_cast<std::size_t>(_adaptiveGrid.x) * _adaptiveGrid.y, 1);
+    _convergedTiles = 0;
+}
+
+void raymarch::Renderer::updateConvergence()
+{
+    if (!_convergenceEnabled) return;
+
+    const std::uint32_t maxSamples = _floatHistory ? config::maxSamples : config::byteHistoryMaxSamples;
+    if (_sampleCount >= maxSamples)
+    {
+        _converged = true;
+        return;
+    }
+
+    // A check lands a few frames after it was issued, the samples since then only lower the error further
+    if (const std::optional<std::vector<TileChange>> tiles = _convergence.poll())
+        applyConvergence(*tiles);
+
+    // Rounding in an RGBA8 history would swamp the error, it stops at its sample limit instead
+    if (!_floatHistory || _sampleCount < _nextConvergenceCheck || _convergence.isPending()) return;
+
+    // Checked at doubling sample counts: from n/2 to n samples the mean moves by about its standard error at n
+    _nextConvergenceCheck = _sampleCount * 2;
+    _convergence.check(_accumulation[_pingpong].getTexture());
+}
+
+void raymarch::Renderer::applyConvergence(const std::vector<TileChange> &tiles)
+{
+    if (tiles.size() != _activeTiles.size()) return;
+
+    const auto relativeError = [](const double squaredError, const double total, const double count)
+    {
+        return std::sqrt(squaredError / count) / std::max(total / count, 1e-3);
+    };
+
+    double squaredError = 0, total = 0, pixels = 0;
+    for (const TileChange& tile : tiles)
+    {
+        squaredError += tile.squaredError;
+        total += tile.luminance;
+        pixels += tile.pixels;
+    }
+    if (pixels == 0) return;
+    _converged = relativeError(squaredError, total, pixels) < config::convergenceThreshold;
+
+    // Quiet tiles stop receiving samples, the image is done once none is left
+    if (config::adaptiveSampling)
+    {
+        for (std::size_t tile = 0; tile < _activeTiles.size(); ++tile)
+        {
+            if (!_activeTiles[tile] || tiles[tile].pixels == 0 ||
+                relativeError(tiles[tile].squaredError, tiles[tile].luminance, tiles[tile].pixels) >= config::convergenceThreshold)
+                continue;
+
+            _activeTiles[tile] = 0;
+            ++_convergedTiles;
+        }
+        _converged = _convergedTiles == _activeTiles.size();
+    }
+}
+
+void raymarch::Renderer::appendAdaptiveTiles(const sf::IntRect &area)
+{
+    const auto tileSize = static_cast<int>(config::adaptiveTileSize);
+    const sf::Vector2i first = area.position / tileSize;
+    const sf::Vector2i last = (area.position + area.size - sf::Vector2i(1, 1)) / tileSize;
+
+    for (int ty = first.y; ty <= last.y; ++ty)
+    {
+        for (int tx = first.x; tx <= last.x; ++tx)
+        {
+            const sf::IntRect tile {{tx * tileSize, ty * tileSize}, {tileSize, tileSize}};
+            const std::optional<sf::IntRect> clipped = tile.findIntersection(area);
+            if (!clipped) continue;
+
+            // Copied texels keep their position, the texture coordinates are the same pixels
+            const sf::Vector2f topLeft = static_cast<sf::Vector2f>(clipped->position);
+            const sf::Vector2f bottomRight = static_cast<sf::Vector2f>(clipped->position + clipped->size);
+            const sf::Vector2f corners[6] = {
+                topLeft, {bottomRight.x, topLeft.y}, bottomRight,
+                topLeft, bottomRight, {topLeft.x, bottomRight.y}
+            };
+
+            const bool active = _activeTiles[static_cast<std::size_t>(ty) * _adaptiveGrid.x + static_cast<std::size_t>(tx)] != 0;
+            sf::VertexArray& vertices = active ? _marchTiles : _copyTiles;
+            for (const sf::Vector2f& corner : corners)
+                vertices.append({corner, sf::Color::White, corner});
+        }
+    }
+}
+
+void raymarch::Renderer::drawAdaptiveTiles(sf::RenderTexture &target, const sf::Texture &history)
+{
+    if (_marchTiles.getVertexCount() > 0)
+    {
+        bindPassTextures(target);
+        target.draw(_marchTiles, getPassStates());
+    }
+
+    if (_copyTiles.getVertexCount() > 0)
+    {
+        sf::RenderStates copyStates;
+        copyStates.texture = &history;
+        copyStates.blendMode = sf::BlendNone;
+        target.draw(_copyTiles, copyStates);
+    }
+
+    _marchTiles.clear();
+    _copyTiles.clear();
+}
+
+bool raymarch::Renderer::selectShaderVariant()
+{
+    // Only the selected estimator is compiled in
+    ShaderDefines defines;
+    if (_parameters.fractal == FractalType::Mandelbox)
+        defines["FRACTAL_MANDELBOX"] = "1";
+    else if (_parameters.fractal == FractalType::Kleinian)
+        defines["FRACTAL_KLEINIAN"] = "1";
+
+    // Specialised code paths for common parameter sets
+    if (config::shaderVariants && _parameters.fractal == FractalType::Mandelbulb && _parameters.power == 8.0f)
+        defines["POWER_8"] = "1";
+
+    // Per-frame camera state in one buffer upload
+    if (config::uniformBuffers && _uniformBuffers)
+        defines["CAMERA_UBO"] = "1";
+
+    if (_shader && defines == _shaderDefines) return true;
+
+    // Dropping optional features one by one, the generic variant of the fractal handles every parameter set
+    sf::Shader* shader = _variants.get(defines);
+    for (const char* optional : {"CAMERA_UBO", "POWER_8"})
+    {
+        if (!shader && defines.erase(optional) > 0)
+            shader = _variants.get(defines);
+    }
+    if (!shader) return false;
+
+    _shader = shader;
+    _shaderDefines = defines;
+    _uniforms.attach(_shader, _shaderDefines.count("CAMERA_UBO") > 0);
+    initShaderUniforms();
+
+    // The watcher rebuilds every variant that may be selected again
+    if (_reloader)
+        _reloader->setVariants(_variants.getCompiledDefines());
+    return true;
+}
+
+void raymarch::Renderer::initShaderUniforms()
+{
+    // Every program has its own uniform state, a freshly selected one knows nothing yet
+    _uniforms.set("iResolution", _resolutionF);
+    _uniforms.set("historySize", _resolutionF);
+    _uniforms.set("tileOrigin", sf::Vector2f(0, 0));
+    setParameterUniforms();
+    _uniforms.set("iTime", 0.0f);
+    _uniforms.set("lastFrame", _accumulation[_pingpong].getTexture());
+    _uniforms.set("blendFactor", config::reprojectionBlend);
+    _uniforms.set("accumulate", true);
+    _uniforms.set("passMode", 0);
+    _uniforms.set("outputSteps", false);
+    _uniforms.set("useConeDistance", false);
+    _uniforms.set("reproject", false);
+    _uniforms.set("sampleIndex", 0.0f);
+    _sampler.apply(_uniforms);
+    setVolumeUniforms();
+
+    // The program has no reference orbit yet, the next camera update uploads it
+    _reference.clear();
+}
+
+void raymarch::Renderer::updateCamera(const Camera &camera, const float iTime)
+{
+    // Deep zoom marches relative to a double precision reference point, the Mandelbox estimator iterates the offsets from it
+    if (const bool perturbation = camera.isDeepZoom() && _parameters.fractal == FractalType::Mandelbox; perturbation != _perturbation)
+    {
+        _perturbation = perturbation;
+        setParameterUniforms();
+        setVolumeUniforms();
+    }
+
+    if (!_perturbation)
+    {
+        _reference.clear();
+    }
+    else if (_reference.update(camera, _parameters))
+    {
+        const auto& orbit = _reference.getOrbit();
+        _shader->setUniformArray("referenceOrbit", orbit.data(), orbit.size());
+    }
+
+    // A length of zero runs the plain estimator
+    if (_parameters.fractal == FractalType::Mandelbox)
+        _uniforms.set("referenceLength", _reference.getLength());
+
+    updateShader(_uniforms, camera, _reference.getPoint(), iTime);
+}
+
+void raymarch::Renderer::setParameterUniforms()
+{
+    _uniforms.set("maxDistance", _parameters.maxDistance);
+    _uniforms.set("epsilon", _parameters.epsilon);
+    _uniforms.set("iterations", _parameters.iterations);
+    // The analytic gradient differentiates the plain estimator, not the offsets from the reference point
+    const NormalMode normals = _perturbation && _parameters.normals == NormalMode::Analytic ? NormalMode::Central : _parameters.normals;
+    _uniforms.set("normalMode", static_cast<int>(normals));
+
+    // Uniforms of estimators that are not compiled in do not exist in the program
+    if (_parameters.fractal == FractalType::Mandelbulb && _shaderDefines.count("POWER_8") == 0)
+        _uniforms.set("power", _parameters.power);
+
+    if (_parameters.fractal == FractalType::Mandelbox)
+    {
+        _uniforms.set("boxScale", _parameters.boxScale);
+        _uniforms.set("boxFoldLimit", _parameters.boxFoldLimit);
+    }
+
+    if (_parameters.fractal != FractalType::Kleinian)
+        _uniforms.set("boundingExtent", getBoundingExtent(_parameters));
+}
+
+void raymarch::Renderer::bakeDistanceVolume()
+{
+    // Baked again for every parameter set, shadows have to match the surface the primary rays find
+    if (_distanceVolume)
+        _volume.bake(_parameters, _shaderDefines);
+    setVolumeUniforms();
+}
+
+void raymarch::Renderer::setVolumeUniforms()
+{
+    // The volume is baked at zoom 1 around the origin, deep zoom lights with the perturbed estimator
+    const bool useVolume = _distanceVolume && _volume.isValid() && !_perturbation;
+    _uniforms.set("useDistanceVolume", useVolume);
+    if (!useVolume) return;
+
+    _uniforms.set("distanceVolume", static_cast<int>(_volume.getTextureUnit()));
+    _uniforms.set("volumeExtent", _volume.getExtent());
+    _uniforms.set("volumeTexel", _volume.getTexelSize());
+}
+
+void raymarch::Renderer::initAccumulation()
+{
+    _floatHistory = true;
+    for (sf::RenderTexture& target : _accumulation)
+    {
+        _floatHistory = gl::makeFloatTarget(target) && _floatHistory;
+        target.setSmooth(true);
+        target.clear();
+    }
+
+    if (!_floatHistory)
+    {
+        std::cerr << "Float render targets are not supported, reprojection is disabled and accumulation stops at "
+                  << config::byteHistoryMaxSamples << " samples" << std::endl;
+        _reprojection = false;
+    }
+}
+
+void raymarch::Renderer::prepareConeDistance(const Camera &camera, const sf::Vector2f &targetSize)
+{
+    if (!_conePrepass) return;
+
+    // Start distances are still valid for this view
+    if (const std::array<float, 20> key = makeConeKey(camera, targetSize); key != _coneKey)
+    {
+        const ProfileScope scope(_profiler, Pass::Prepass);
+        drawConeLevel(0, targetSize);
+        drawConeLevel(1, targetSize);
+        _coneKey = key;
+    }
+
+    _uniforms.set("useConeDistance", true);
+    bindConeLevel(1, coneDivisors[1]);
+}
+
+void raymarch::Renderer::drawConeLevel(const int level, const sf::Vector2f &targetSize)
+{
+    // Fractional resolution keeps the cone pixels aligned to blocks of full resolution pixels
+    const sf::Vector2f levelSize = targetSize / coneDivisors[level];
+    const sf::Vector2u textureSize {
+        static_cast<unsigned int>(std::ceil(levelSize.x)),
+        static_cast<unsigned int>(std::ceil(levelSize.y))
+    };
+
+    sf::RenderTexture& target = _conePass[level];
+    if (target.getSize() != textureSize && !target.resize(textureSize))
+        std::cerr << "Failed to resize cone pre-pass texture" << std::endl;
+
+    _uniforms.set("passMode", 1);
+    _uniforms.set("iResolution", levelSize);
+    _uniforms.set("useConeDistance", level > 0);
+    if (level > 0)
+        bindConeLevel(level - 1, coneDivisors[level - 1] / coneDivisors[level]);
+
+    _fullScreenQuad.setSize(static_cast<sf::Vector2f>(textureSize));
+
+    _uniforms.flush();
+    bindPassTextures(target);
+    target.clear();
+    target.draw(_fullScreenQuad, getPassStates());
+    target.display();
+
+    _uniforms.set("passMode", 0);
+}
+
+void raymarch::Renderer::bindConeLevel(const int level, const float coneScale)
+{
+    _uniforms.set("coneDistance", _conePass[level].getTexture());
+    _uniforms.set("coneTextureSize", static_cast<sf::Vector2f>(_conePass[level].getSize()));
+    _uniforms.set("coneScale", coneScale);
+}
+
+sf::RenderStates raymarch::Renderer::getPassStates() const
+{
+    // Alpha holds pass data rather than coverage, blending would scale the colour by it
+    sf::RenderStates states(_shader);
+    states.blendMode = sf::BlendNone;
+    return states;
+}
+
+void raymarch::Renderer::bindPassTextures(sf::RenderTarget &target) const
+{
+    // The volume lives outside SFML's texture units, it is bound on the context of the target that draws next
+    if (_volume.isValid() && target.setActive(true))
+        _volume.bind();
+}
+
+void raymarch::Renderer::setPassUniforms(const sf::Vector2f &targetSize, const bool accumulate)
+{
+    _uniforms.set("iResolution", targetSize);
+    _uniforms.set("historySize", targetSize);
+    _uniforms.set("sampleIndex", static_cast<float>(_passSampleIndex));
+    _uniforms.set("accumulate", accumulate);
+}
+
+const sf::Texture& raymarch::Renderer::getTexture() const
+{
+    return _scaledOutput ? _scaledTarget.getTexture() : _accumulation[_pingpong].getTexture();
+}
+
+sf::RenderTexture& raymarch::Renderer::getTarget()
+{
+    return _scaledOutput ? _scaledTarget : _accumulation[_pingpong];
+}
+
+sf::Shader& raymarch::Renderer::getShader()
+{
+    return *_shader;
+}
+
+sf::Vector2u raymarch::Renderer::getResolution() const
+{
+    return _resolution;
+}
+
+const raymarch::FractalParameters& raymarch::Renderer::getParameters() const
+{
+    return _parameters;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <SFML/Graphics.hpp>
+
+#include "camera.hpp"
+#include "convergence.hpp"
+#include "distancevolume.hpp"
+#include "heatmap.hpp"
+#include "parameters.hpp"
+#include "profiler.hpp"
+#include "referenceorbit.hpp"
+#include "sampler.hpp"
+#include "shaderreloader.hpp"
+#include "shadervariants.hpp"
+#include "tilescheduler.hpp"
+#include "uniformcache.hpp"
+
+namespace raymarch
+{
+    // Distance estimator evaluations of one frame, read back from the step counting output
+    struct StepCount
+    {
+        std::uint64_t prepass = 0;
+        std::uint64_t shading = 0;
+        std::uint64_t pixels = 0;
+
+        [[nodiscard]] std::uint64_t total() const;
+    };
+
+    // Camera state a frame was rendered with, used to reproject its history
+    struct ViewState
+    {
+        sf::Vector3<double> position;
+        std::array<float, 9> rotation {};
+        float fov = 0;
+        float aperture = 0;
+        float focusDistance = 0;
+
+        static ViewState fromCamera(const Camera &camera);
+        bool operator==(const ViewState &other) const;
+        bool operator!=(const ViewState &other) const;
+    };
+
+    class Renderer
+    {
+    public:
+        explicit Renderer(const sf::Vector2u &resolution);
+
+        bool loadShader(const std::filesystem::path &path);
+        void setHotReload(bool enabled);
+        bool applyShaderReload();
+        void resize(const sf::Vector2u &resolution);
+        void seed(unsigned int seed);
+        void setParameters(const FractalParameters &parameters);
+        void render(const Camera &camera, float iTime, bool accumulate);
+        void renderScaled(const Camera &camera, float iTime, float renderScale);
+        void finish();
+        void draw(sf::RenderTarget &target) const;
+        void setFrameBudget(float milliseconds);
+        void setConePrepass(bool enabled);
+        void setDistanceVolume(bool enabled);
+        void setReprojection(bool enabled);
+
+        // Without it every frame marches the whole image, the benchmark times the march rather than how soon it converged
+        void setConvergence(bool enabled);
+        void setProfiler(Profiler* profiler);
+        [[nodiscard]] bool isReprojecting() const;
+        [[nodiscard]] bool isConverged() const;
+
+        // The converged history shows this view, accumulating it again would not change the image
+        [[nodiscard]] bool isFinal(const Camera &camera) const;
+        [[nodiscard]] std::uint32_t getSampleCount() const;
+        [[nodiscard]] StepCount countSteps(const Camera &camera, float iTime);
+
+        // Region of a larger image at a fixed sample count, RGBA floats with the bottom row first
+        [[nodiscard]] std::vector<float> renderRegion(const Camera &camera, const sf::Vector2u &imageSize, const sf::IntRect &region, uint32_t samples);
+
+        void setHeatmap(HeatmapChannel channel);
+        [[nodiscard]] HeatmapChannel getHeatmap() const;
+        bool renderDiagnostics(const Camera &camera, float iTime);
+        [[nodiscard]] std::vector<float> readDiagnostics();
+
+        // Normal of the primary hit per pixel, RGBA floats with alpha 1 where the ray hit, empty without a float target
+        [[nodiscard]] std::vector<float> renderNormals(const Camera &camera);
+
+        [[nodiscard]] const sf::Texture& getTexture() const;
+        [[nodiscard]] sf::RenderTexture& getTarget();
+        [[nodiscard]] sf::Shader& getShader();
+        [[nodiscard]] sf::Vector2u getResolution() const;
+        [[nodiscard]] const FractalParameters& getParameters() const;
+    private:
+        sf::Vector2u _resolution;
+        sf::Vector2f _resolutionF;
+        FractalParameters _parameters;
+
+        // Fullscreen-Quad that is the "canvas" for our renderer
+        sf::RectangleShape _fullScreenQuad;
+
+        // Accumulation textures (ping-pong)
+        sf::RenderTexture _accumulation[2];
+        int _pingpong = 0;
+
+        // Ray-marching shader, the variant specialised for the current parameters
+        ShaderVariantCache _variants;
+        sf::Shader* _shader = nullptr;
+        ShaderDefines _shaderDefines;
+        UniformCache _uniforms;
+        bool _uniformBuffers = false;
+        std::filesystem::path _shaderPath;
+        std::unique_ptr<ShaderReloader> _reloader;
+
+        // Float history with the camera distance in alpha, reprojected while the camera moves
+        bool _floatHistory = false;
+        bool _reprojection = false;
+        ViewState _historyView;
+
+        // Samples in the running mean of the history, rendering stops once it has converged
+        std::uint32_t _sampleCount = 0;
+        std::uint32_t _nextConvergenceCheck = 0;
+        ConvergenceEstimator _convergence;
+        bool _converged = false;
+        bool _convergenceEnabled = true;
+
+        // Converged tiles only copy their history forward, the rest are marched as one batch
+        sf::Vector2u _adaptiveGrid;
+        std::vector<std::uint8_t> _activeTiles;
+        std::size_t _convergedTiles = 0;
+        sf::VertexArray _marchTiles {sf::PrimitiveType::Triangles};
+        sf::VertexArray _copyTiles {sf::PrimitiveType::Triangles};
+
+        // Progressive tiles of the full resolution pass
+        TileScheduler _tiles;
+
+        // Tile costs come from the profiler's timer queries a few frames late, the clock is the fallback without them
+        PassTimeQueue _tileTimes {Pass::Accumulation};
+        sf::Clock _tileClock;
+
+        // Conservative start distances at 1/8 and 1/4 resolution
+        sf::RenderTexture _conePass[2];
+        bool _conePrepass;
+        std::optional<std::array<float, 20>> _coneKey;
+
+        // Estimator baked for the shadow and AO rays
+        DistanceVolume _volume;
+        bool _distanceVolume;
+
+        // Reduced resolution target used while the camera moves
+        sf::RenderTexture _scaledTarget;
+        bool _scaledOutput = false;
+        bool _historyValid = true;
+
+        // Float ping-pong targets of offline region renders
+        sf::RenderTexture _region[2];
+
+        // Per-pixel march counters and the shader that shows one of them as a heatmap
+        sf::RenderTexture _diagnostics;
+        sf::Shader _heatmapShader;
+        bool _heatmapAvailable = false;
+        HeatmapChannel _heatmap = HeatmapChannel::None;
+
+        // Low-discrepancy samples for accumulation, the index restarts with every fresh history
+        Sampler _sampler;
+        std::uint32_t _sampleIndex = 0;
+        std::uint32_t _passSampleIndex = 0;
+
+        // Deep zoom reference point of the Mandelbox, positions reach the shader relative to it
+        ReferenceOrbit _reference;
+        bool _perturbation = false;
+
+        // Optional pass timings, not owned
+        Profiler* _profiler = nullptr;
+
+        bool selectShaderVariant();
+        void initShaderUniforms();
+        void updateCamera(const Camera &camera, float iTime);
+        void setParameterUniforms();
+        void bakeDistanceVolume();
+        void setVolumeUniforms();
+        void initAccumulation();
+        void drawPass(sf::RenderTexture &target, bool accumulate);
+        void completePass(const ViewState &view, bool reprojected, bool accumulated);
+        void resetConvergence();
+        void updateConvergence();
+        void applyConvergence(const std::vector<TileChange> &tiles);
+        void appendAdaptiveTiles(const sf::IntRect &area);
+        void drawAdaptiveTiles(sf::RenderTexture &target, const sf::Texture &history);
+        void prepareConeDistance(const Camera &camera, const sf::Vector2f &targetSize);
+        void drawConeLevel(int level, const sf::Vector2f &targetSize);
+        void bindConeLevel(int level, float coneScale);
+        void setPassUniforms(const sf::Vector2f &targetSize, bool accumulate);
+        bool drawFloatPass(const Camera &camera, float iTime, int passMode);
+        [[nodiscard]] sf::RenderStates getPassStates() const;
+        void bindPassTextures(sf::RenderTarget &target) const;
+    };
+}
@@ -0,0 +1,77 @@
+#include "resolutionscaler.hpp"
+
+#include <cmath>
+
+raymarch::ResolutionScaler::ResolutionScaler(const float targetFrameTime) :
+    _targetFrameTime(targetFrameTime)
+{
+}
+
+void raymarch::ResolutionScaler::update(const float frameTime)
+{
+    // Smoothing out single spikes
+    _averageFrameTime = (_averageFrameTime == 0) ? frameTime : _averageFrameTime + (frameTime - _averageFrameTime) * _smoothing;
+
+    if (_averageFrameTime > _targetFrameTime * _downscaleThreshold)
+    {
+        _framesUnderBudget = 0;
+        if (++_framesOverBudget >= _downscaleFrames && _level + 1 < _scales.size())
+            setLevel(_level + 1);
+        return;
+    }
+    _framesOverBudget = 0;
+
+    if (_level == 0) return;
+
+    // Cost is proportional to the pixel count, so predicting the frame time of the next level up
+    const float ratio = _scales[_level - 1] / _scales[_level];
+    const float predictedFrameTime = _averageFrameTime * ratio * ratio;
+
+    if (predictedFrameTime < _targetFrameTime * _upscaleThreshold)
+    {
+        if (++_framesUnderBudget >= _upscaleFrames)
+            setLevel(_level - 1);
+    }
+    else
+    {
+        _framesUnderBudget = 0;
+    }
+}
+
+void raymarch::ResolutionScaler::update(const float frameTime, const float scale)
+{
+    if (scale <= 0) return;
+
+    // Cost is proportional to the pixel count, so converting to the current level
+    const float ratio = getScale() / scale;
+    update(frameTime * ratio * ratio);
+}
+
+void raymarch::ResolutionScaler::reset()
+{
+    _level = 0;
+    _averageFrameTime = 0;
+    _framesOverBudget = 0;
+    _framesUnderBudget = 0;
+}
+
+float raymarch::ResolutionScaler::getScale() const
+{
+    return _scales[_level];
+}
+
+float raymarch::ResolutionScaler::getAverageFrameTime() const
+{
+    return _averageFrameTime;
+}
+
+void raymarch::ResolutionScaler::setLevel(const std::size_t level)
+{
+    // Rescaling the running average to the expected cost of the new level
+    const float ratio = _scales[level] / _scales[_level];
+    _averageFrameTime *= ratio * ratio;
+
+    _level = level;
+    _framesOverBudget = 0;
+    _framesUnderBudget = 0;
+}
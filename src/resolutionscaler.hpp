@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+
+namespace raymarch
+{
+    // Picks the render scale used during camera motion from measured frame times
+    class ResolutionScaler
+    {
+    public:
+        explicit ResolutionScaler(float targetFrameTime);
+
+        void update(float frameTime);
+
+        // Frame time of a frame rendered at another scale, measurements that arrive late may predate a level change
+        void update(float frameTime, float scale);
+        void reset();
+
+        [[nodiscard]] float getScale() const;
+        [[nodiscard]] float getAverageFrameTime() const;
+    private:
+        static constexpr std::array<float, 7> _scales {1.0f, 0.85f, 0.7f, 0.6f, 0.5f, 0.35f, 0.25f};
+
+        // Hysteresis: scale down quickly when over budget, scale up only when the next level clearly fits
+        static constexpr float _downscaleThreshold = 1.05f;
+        static constexpr float _upscaleThreshold = 0.85f;
+        static constexpr int _downscaleFrames = 3;
+        static constexpr int _upscaleFrames = 20;
+        static constexpr float _smoothing = 0.2f;
+
+        float _targetFrameTime;
+        float _averageFrameTime = 0;
+        std::size_t _level = 0;
+        int _framesOverBudget = 0;
+        int _framesUnderBudget = 0;
+
+        void setLevel(std::size_t level);
+    };
+}
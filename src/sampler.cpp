@@ -0,0 +1,172 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "config.hpp"
+
+namespace
+{
+    constexpr float blueNoiseSigma = 1.5f;
+    constexpr float initialDensity = 0.1f;
+
+    class EnergyField
+    {
+    public:
+        explicit EnergyField(const unsigned int size) :
+            _size(size),
+            _kernel(static_cast<std::size_t>(size) * size),
+            _energy(_kernel.size(), 0.0f),
+            _pattern(_kernel.size(), 0)
+        {
+            // Gaussian weight of every toroidal offset, so the texture tiles seamlessly
+            for (unsigned int y = 0; y < size; ++y)
+            {
+                for (unsigned int x = 0; x < size; ++x)
+                {
+                    const float dx = static_cast<float>(std::min(x, size - x));
+                    const float dy = static_cast<float>(std::min(y, size - y));
+                    _kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * blueNoiseSigma * blueNoiseSigma));
+                }
+            }
+        }
+
+        void set(const std::size_t index, const bool value)
+        {
+            if ((_pattern[index] != 0) == value) return;
+            _pattern[index] = value ? 1 : 0;
+
+            const std::size_t px = index % _size;
+            const std::size_t py = index / _size;
+            const float sign = value ? 1.0f : -1.0f;
+            for (std::size_t y = 0; y < _size; ++y)
+            {
+                const std::size_t ky = (y + _size - py) % _size * _size;
+                for (std::size_t x = 0; x < _size; ++x)
+                    _energy[y * _size + x] += sign * _kernel[ky + (x + _size - px) % _size];
+            }
+        }
+
+        [[nodiscard]] bool isSet(const std::size_t index) const
+        {
+            return _pattern[index] != 0;
+        }
+
+        // Set texel with the most energy around it
+        [[nodiscard]] std::size_t tightestCluster() const
+        {
+            return find(1, [](const float a, const float b) { return a > b; });
+        }
+
+        // Empty texel with the least energy around it, also the tightest cluster of empty texels
+        [[nodiscard]] std::size_t largestVoid() const
+        {
+            return find(0, [](const float a, const float b) { return a < b; });
+        }
+    private:
+        std::size_t _size;
+        std::vector<float> _kernel;
+        std::vector<float> _energy;
+        std::vector<std::uint8_t> _pattern;
+
+        template <typename Better>
+        [[nodiscard]] std::size_t find(const std::uint8_t value, Better better) const
+        {
+            std::size_t best = _pattern.size();
+            for (std::size_t i = 0; i < _pattern.size(); ++i)
+            {
+                if (_pattern[i] == value && (best == _pattern.size() || better(_energy[i], _energy[best])))
+                    best = i;
+            }
+            return best;
+        }
+    };
+}
+
+std::vector<float> raymarch::generateBlueNoise(const unsigned int size, const std::uint32_t seed)
+{
+    const std::size_t count = static_cast<std::size_t>(size) * size;
+    std::vector<float> ranks(count, 0.0f);
+
+    // Random initial points, relaxed until moving the tightest cluster into the largest void changes nothing
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::size_t> texel(0, count - 1);
+    EnergyField initial(size);
+    const auto initialCount = static_cast<std::size_t>(static_cast<float>(count) * initialDensity);
+    for (std::size_t placed = 0; placed < initialCount;)
+    {
+        const std::size_t index = texel(rng);
+        if (initial.isSet(index)) continue;
+        initial.set(index, true);
+        ++placed;
+    }
+
+    for (std::size_t swap = 0; swap < count; ++swap)
+    {
+        const std::size_t cluster = initial.tightestCluster();
+        initial.set(cluster, false);
+        const std::size_t emptiest = initial.largestVoid();
+        initial.set(emptiest, true);
+        if (emptiest == cluster) break;
+    }
+
+    // Ranks below the initial points: removing the tightest cluster first
+    EnergyField field = initial;
+    for (std::size_t rank = initialCount; rank-- > 0;)
+    {
+        const std::size_t cluster = field.tightestCluster();
+        field.set(cluster, false);
+        ranks[cluster] = static_cast<float>(rank);
+    }
+
+    // Ranks above: filling the largest void, which is also the tightest cluster of empty texels
+    field = initial;
+    for (std::size_t rank = initialCount; rank < count; ++rank)
+    {
+        const std::size_t emptiest = field.largestVoid();
+        field.set(emptiest, true);
+        ranks[emptiest] = static_cast<float>(rank);
+    }
+
+    for (float& rank : ranks)
+        rank = (rank + 0.5f) / static_cast<float>(count);
+    return ranks;
+}
+
+raymarch::Sampler::Sampler()
+{
+    // Two independent channels, one per axis of a 2D sample
+    const unsigned int size = config::blueNoiseSize;
+    std::vector<std::uint8_t> pixels(static_cast<std::size_t>(size) * size * 4, 255);
+    for (unsigned int channel = 0; channel < 2; ++channel)
+    {
+        const std::vector<float> noise = generateBlueNoise(size, config::blueNoiseSeed + channel);
+        for (std::size_t i = 0; i < noise.size(); ++i)
+            pixels[i * 4 + channel] = static_cast<std::uint8_t>(noise[i] * 256.0f);
+    }
+
+    if (!_blueNoise.resize({size, size}))
+        std::cerr << "Failed to create blue noise texture" << std::endl;
+    _blueNoise.update(pixels.data());
+    _blueNoise.setRepeated(true);
+    _blueNoise.setSmooth(false);
+
+    seed(std::random_device{}());
+}
+
+void raymarch::Sampler::seed(const std::uint32_t seed)
+{
+    // Cranley-Patterson rotation shared by every pixel, the sequences stay stratified
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> offset(0.0f, 1.0f);
+    _scramble = {offset(rng), offset(rng)};
+}
+
+void raymarch::Sampler::apply(UniformCache &uniforms) const
+{
+    uniforms.set("blueNoise", _blueNoise);
+    uniforms.set("blueNoiseSize", static_cast<sf::Vector2f>(_blueNoise.getSize()));
+    uniforms.set("samplerScramble", _scramble);
+}
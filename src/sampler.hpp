@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "uniformcache.hpp"
+
+namespace raymarch
+{
+    // Void-and-cluster blue noise (Ulichney), the rank of every texel of a tileable square in [0, 1)
+    [[nodiscard]] std::vector<float> generateBlueNoise(unsigned int size, std::uint32_t seed);
+
+    // Per-pixel low-discrepancy samples for shaders/sampler.glsl: R2 sequences over the sample index, rotated by blue noise
+    class Sampler
+    {
+    public:
+        Sampler();
+
+        void seed(std::uint32_t seed);
+        void apply(UniformCache &uniforms) const;
+    private:
+        sf::Texture _blueNoise;
+        sf::Vector2f _scramble;
+    };
+}
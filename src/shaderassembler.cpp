@@ -0,0 +1,162 @@
+#include "shaderassembler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+namespace
+{
+    std::string trimLeft(const std::string &line)
+    {
+        const std::size_t first = line.find_first_not_of(" \t");
+        return first == std::string::npos ? std::string() : line.substr(first);
+    }
+
+    // Directive name after '#', which may be separated from it by whitespace
+    bool isDirective(const std::string &trimmed, const std::string &name)
+    {
+        if (trimmed.empty() || trimmed[0] != '#') return false;
+        return trimLeft(trimmed.substr(1)).compare(0, name.size(), name) == 0;
+    }
+
+    bool parseIncludeName(const std::string &trimmed, std::string &name)
+    {
+        const std::size_t open = trimmed.find_first_of("\"<");
+        if (open == std::string::npos) return false;
+
+        const char closing = trimmed[open] == '"' ? '"' : '>';
+        const std::size_t close = trimmed.find(closing, open + 1);
+        if (close == std::string::npos) return false;
+
+        name = trimmed.substr(open + 1, close - open - 1);
+        return !name.empty();
+    }
+}
+
+bool raymarch::ShaderAssembler::assemble(const std::filesystem::path &path)
+{
+    _source.clear();
+    _files.clear();
+    _includeStack.clear();
+    return appendFile(path);
+}
+
+const std::string& raymarch::ShaderAssembler::getSource() const
+{
+    return _source;
+}
+
+const std::vector<std::filesystem::path>& raymarch::ShaderAssembler::getFiles() const
+{
+    return _files;
+}
+
+std::string raymarch::ShaderAssembler::mapLog(const std::string &log) const
+{
+    // Drivers report locations as "file:line" (Mesa, AMD) or "file(line)" (NVIDIA), with the file as a number
+    static const std::regex location(R"((\d+)(?::(\d+)|\((\d+)\)))");
+
+    std::istringstream input(log);
+    std::ostringstream output;
+    std::string line;
+
+    while (std::getline(input, line))
+    {
+        std::smatch match;
+        if (std::regex_search(line, match, location))
+        {
+            const std::size_t file = std::stoul(match[1].str());
+            const std::string lineNumber = match[2].matched ? match[2].str() : match[3].str();
+
+            if (file < _files.size())
+                line = match.prefix().str() + _files[file].string() + ":" + lineNumber + match.suffix().str();
+        }
+        output << line << '\n';
+    }
+
+    return output.str();
+}
+
+bool raymarch::ShaderAssembler::appendFile(const std::filesystem::path &path)
+{
+    std::error_code error;
+    const std::filesystem::path file = std::filesystem::weakly_canonical(path, error);
+
+    if (std::find(_includeStack.begin(), _includeStack.end(), file) != _includeStack.end())
+    {
+        std::cerr << "Shader include cycle at " << path << std::endl;
+        return false;
+    }
+
+    // Include guard: a file that was already pasted is skipped
+    if (std::find(_files.begin(), _files.end(), file) != _files.end())
+        return true;
+
+    std::ifstream stream(file);
+    if (!stream)
+    {
+        std::cerr << "Failed to read shader source " << path << std::endl;
+        return false;
+    }
+
+    const std::size_t index = _files.size();
+    _files.push_back(file);
+    _includeStack.push_back(file);
+
+    const std::string fileNumber = " " + std::to_string(index);
+    std::string line;
+    int lineNumber = 0;
+    bool lineMapped = false;
+
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+        const std::string trimmed = trimLeft(line);
+
+        // #version has to stay the very first directive of the program
+        if (isDirective(trimmed, "version"))
+        {
+            _source += line + '\n';
+            continue;
+        }
+
+        if (!lineMapped)
+        {
+            _source += "#line " + std::to_string(lineNumber) + fileNumber + '\n';
+            lineMapped = true;
+        }
+
+        if (isDirective(trimmed, "pragma once"))
+        {
+            _source += '\n';
+            continue;
+        }
+
+        if (isDirective(trimmed, "include"))
+        {
+            std::string name;
+            if (!parseIncludeName(trimmed, name))
+            {
+                std::cerr << file.string() << ":" << lineNumber << ": malformed #include" << std::endl;
+                return false;
+            }
+
+            if (!appendFile(file.parent_path() / name))
+            {
+                std::cerr << "  included from " << file.string() << ":" << lineNumber << std::endl;
+                return false;
+            }
+
+            // Back in this file after the included one
+            _source += "#line " + std::to_string(lineNumber + 1) + fileNumber + '\n';
+            continue;
+        }
+
+        _source += line + '\n';
+    }
+
+    _includeStack.pop_back();
+    return true;
+}
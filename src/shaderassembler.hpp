@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace raymarch
+{
+    // Resolves #include "file" directives of a GLSL source, every file is pasted at most once.
+    // #line directives number the files in inclusion order, so compiler messages can be mapped back.
+    class ShaderAssembler
+    {
+    public:
+        bool assemble(const std::filesystem::path &path);
+
+        [[nodiscard]] const std::string& getSource() const;
+        [[nodiscard]] const std::vector<std::filesystem::path>& getFiles() const;
+        [[nodiscard]] std::string mapLog(const std::string &log) const;
+    private:
+        std::string _source;
+        std::vector<std::filesystem::path> _files;
+        std::vector<std::filesystem::path> _includeStack;
+
+        bool appendFile(const std::filesystem::path &path);
+    };
+}
@@ -0,0 +1,103 @@
+#include "shaderreloader.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <SFML/OpenGL.hpp>
+
+#include "config.hpp"
+
+raymarch::ShaderReloader::ShaderReloader(std::filesystem::path sourcePath, std::filesystem::path cacheDirectory) :
+    _sourcePath(std::move(sourcePath)),
+    _cacheDirectory(std::move(cacheDirectory))
+{
+    // Baseline, the files as they are now are already compiled
+    static_cast<void>(scanForChanges());
+    _thread = std::thread(&ShaderReloader::run, this);
+}
+
+raymarch::ShaderReloader::~ShaderReloader()
+{
+    {
+        const std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+void raymarch::ShaderReloader::setVariants(std::vector<ShaderDefines> variants)
+{
+    const std::lock_guard lock(_mutex);
+    _variants = std::move(variants);
+}
+
+std::unique_ptr<raymarch::ShaderVariantCache> raymarch::ShaderReloader::takeReloaded()
+{
+    const std::lock_guard lock(_mutex);
+    return std::move(_reloaded);
+}
+
+void raymarch::ShaderReloader::run()
+{
+    // Shared with the main context, programs linked here can be used there
+    sf::Context context;
+
+    std::unique_lock lock(_mutex);
+    while (!_wake.wait_for(lock, std::chrono::milliseconds(config::shaderReloadInterval), [this] { return _stop; }))
+    {
+        lock.unlock();
+        const bool changed = scanForChanges();
+        lock.lock();
+        if (!changed) continue;
+
+        const std::vector<ShaderDefines> variants = _variants;
+        lock.unlock();
+
+        std::cout << "Shader sources changed, recompiling " << variants.size() << " variant(s)" << std::endl;
+        std::unique_ptr<ShaderVariantCache> reloaded = rebuild(variants);
+
+        lock.lock();
+        if (reloaded)
+            _reloaded = std::move(reloaded);
+    }
+}
+
+bool raymarch::ShaderReloader::scanForChanges()
+{
+    std::error_code error;
+    std::map<std::filesystem::path, std::filesystem::file_time_type> timestamps;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(_sourcePath.parent_path(), error))
+    {
+        if (entry.is_regular_file(error))
+            timestamps[entry.path()] = entry.last_write_time(error);
+    }
+
+    // Editors often replace files, a new or removed file counts as a change too
+    const bool changed = timestamps != _timestamps;
+    _timestamps = std::move(timestamps);
+    return changed;
+}
+
+std::unique_ptr<raymarch::ShaderVariantCache> raymarch::ShaderReloader::rebuild(const std::vector<ShaderDefines> &variants) const
+{
+    auto cache = std::make_unique<ShaderVariantCache>(_cacheDirectory);
+    if (!cache->loadSource(_sourcePath))
+    {
+        std::cerr << "Shader reload failed, keeping the previous program" << std::endl;
+        return nullptr;
+    }
+
+    for (const ShaderDefines& defines : variants)
+    {
+        if (!cache->get(defines))
+        {
+            std::cerr << "Shader reload failed, keeping the previous program" << std::endl;
+            return nullptr;
+        }
+    }
+
+    // The programs have to be complete before another context uses them
+    glFinish();
+    return cache;
+}
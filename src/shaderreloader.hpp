@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "shadervariants.hpp"
+
+namespace raymarch
+{
+    // Watches the shader directory and rebuilds the variants in use on a background shared context
+    class ShaderReloader
+    {
+    public:
+        ShaderReloader(std::filesystem::path sourcePath, std::filesystem::path cacheDirectory);
+        ~ShaderReloader();
+
+        ShaderReloader(const ShaderReloader&) = delete;
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        void setVariants(std::vector<ShaderDefines> variants);
+        // A fully compiled replacement cache, or nullptr while nothing new is ready
+        [[nodiscard]] std::unique_ptr<ShaderVariantCache> takeReloaded();
+    private:
+        std::filesystem::path _sourcePath;
+        std::filesystem::path _cacheDirectory;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        bool _stop = false;
+        std::vector<ShaderDefines> _variants;
+        std::unique_ptr<ShaderVariantCache> _reloaded;
+
+        // Only touched by the watcher thread
+        std::map<std::filesystem::path, std::filesystem::file_time_type> _timestamps;
+
+        std::thread _thread;
+
+        void run();
+        [[nodiscard]] bool scanForChanges();
+        [[nodiscard]] std::unique_ptr<ShaderVariantCache> rebuild(const std::vector<ShaderDefines> &variants) const;
+    };
+}
@@ -0,0 +1,221 @@
+#include "shadervariants.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    std::string makeKey(const raymarch::ShaderDefines &defines)
+    {
+        std::string key;
+        for (const auto& [name, value] : defines)
+            key += name + "=" + value + ";";
+        return key;
+    }
+
+    // FNV-1a, only used to name cache files
+    std::uint64_t hashString(const std::string &text)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const char c : text)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // sf::err is routed through this buffer once, so a thread can collect what it writes without swapping buffers
+    class ErrorRouter : public std::streambuf
+    {
+    public:
+        explicit ErrorRouter(std::ostream &stream) :
+            _stream(stream),
+            _fallback(stream.rdbuf(this))
+        {}
+
+        ~ErrorRouter() override
+        {
+            _stream.rdbuf(_fallback);
+        }
+
+        static thread_local std::string* capture;
+    protected:
+        int overflow(const int character) override
+        {
+            if (character == traits_type::eof()) return traits_type::not_eof(character);
+            if (capture)
+            {
+                capture->push_back(static_cast<char>(character));
+                return character;
+            }
+            return _fallback->sputc(static_cast<char>(character));
+        }
+
+        std::streamsize xsputn(const char* text, const std::streamsize count) override
+        {
+            if (capture)
+            {
+                capture->append(text, static_cast<std::size_t>(count));
+                return count;
+            }
+            return _fallback->sputn(text, count);
+        }
+
+        int sync() override
+        {
+            return capture ? 0 : _fallback->pubsync();
+        }
+    private:
+        std::ostream& _stream;
+        std::streambuf* _fallback;
+    };
+
+    thread_local std::string* ErrorRouter::capture = nullptr;
+
+    // Captures sf::err on the calling thread while in scope
+    class ErrorCapture
+    {
+    public:
+        explicit ErrorCapture(std::string &log)
+        {
+            static ErrorRouter router(sf::err());
+            ErrorRouter::capture = &log;
+        }
+
+        ~ErrorCapture()
+        {
+            ErrorRouter::capture = nullptr;
+        }
+
+        ErrorCapture(const ErrorCapture&) = delete;
+        ErrorCapture& operator=(const ErrorCapture&) = delete;
+    };
+
+    bool readFile(const std::filesystem::path &path, std::string &contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+        return true;
+    }
+}
+
+raymarch::ShaderVariantCache::ShaderVariantCache(std::filesystem::path cacheDirectory) :
+    _cacheDirectory(std::move(cacheDirectory))
+{}
+
+bool raymarch::ShaderVariantCache::loadSource(const std::filesystem::path &path)
+{
+    if (!_assembler.assemble(path)) return false;
+
+    // Variants of the previous source are stale
+    if (_assembler.getSource() != _source || path != _sourcePath)
+        clear();
+
+    _sourcePath = path;
+    _source = _assembler.getSource();
+    return true;
+}
+
+sf::Shader* raymarch::ShaderVariantCache::get(const ShaderDefines &defines)
+{
+    const std::string key = makeKey(defines);
+
+    if (const auto variant = _variants.find(key); variant != _variants.end())
+        return variant->second.shader.get();
+
+    // A variant that failed to compile is not retried every frame
+    if (_failed.count(key) > 0) return nullptr;
+
+    // Generated sources are kept on disk, a cached file is only reused while it matches the current source
+    const std::filesystem::path cachePath = getCachePath(key);
+    std::string source;
+    if (!readFile(cachePath, source))
+    {
+        source = generateSource(defines);
+
+        std::error_code error;
+        std::filesystem::create_directories(_cacheDirectory, error);
+        if (std::ofstream file(cachePath, std::ios::binary); file)
+            file << source;
+    }
+
+    // SFML reports the compile log on sf::err, with file numbers instead of names
+    std::string log;
+    auto shader = std::make_unique<sf::Shader>();
+    bool compiled;
+    {
+        const ErrorCapture capture(log);
+        compiled = shader->loadFromMemory(source, sf::Shader::Type::Fragment);
+    }
+
+    if (!compiled)
+    {
+        std::cerr << _assembler.mapLog(log);
+        std::cerr << "Failed to compile shader variant " << (key.empty() ? "<default>" : key) << std::endl;
+        _failed.insert(key);
+        return nullptr;
+    }
+
+    return _variants.emplace(key, Variant {defines, std::move(shader)}).first->second.shader.get();
+}
+
+void raymarch::ShaderVariantCache::clear()
+{
+    _variants.clear();
+    _failed.clear();
+}
+
+std::size_t raymarch::ShaderVariantCache::getVariantCount() const
+{
+    return _variants.size();
+}
+
+std::vector<raymarch::ShaderDefines> raymarch::ShaderVariantCache::getCompiledDefines() const
+{
+    std::vector<ShaderDefines> defines;
+    for (const auto& [key, variant] : _variants)
+        defines.push_back(variant.defines);
+    return defines;
+}
+
+const std::vector<std::filesystem::path>& raymarch::ShaderVariantCache::getSourceFiles() const
+{
+    return _assembler.getFiles();
+}
+
+std::string raymarch::ShaderVariantCache::generateSource(const ShaderDefines &defines) const
+{
+    std::string block;
+    for (const auto& [name, value] : defines)
+        block += "#define " + name + " " + value + "\n";
+
+    // Defines go after #version, which has to stay the first directive
+    std::size_t insertAt = 0;
+    if (_source.compare(0, 8, "#version") == 0)
+    {
+        insertAt = _source.find('\n');
+        insertAt = insertAt == std::string::npos ? _source.size() : insertAt + 1;
+    }
+
+    // The assembled source maps its own lines, so the defines need no #line of their own
+    std::string source = _source;
+    source.insert(insertAt, block);
+    return source;
+}
+
+std::filesystem::path raymarch::ShaderVariantCache::getCachePath(const std::string &key) const
+{
+    // The base source is part of the hash, edits to it never hit an old file
+    std::ostringstream name;
+    name << _sourcePath.stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0')
+         << hashString(_source + '\0' + key) << _sourcePath.extension().string();
+    return _cacheDirectory / name.str();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "shaderassembler.hpp"
+
+namespace raymarch
+{
+    // Preprocessor defines of one variant, ordered so equal sets produce equal sources
+    using ShaderDefines = std::map<std::string, std::string>;
+
+    // Compiles specialised variants of one fragment shader, with its includes resolved, on first use and keeps them
+    class ShaderVariantCache
+    {
+    public:
+        explicit ShaderVariantCache(std::filesystem::path cacheDirectory);
+
+        bool loadSource(const std::filesystem::path &path);
+        [[nodiscard]] sf::Shader* get(const ShaderDefines &defines);
+        void clear();
+
+        [[nodiscard]] std::size_t getVariantCount() const;
+        [[nodiscard]] std::vector<ShaderDefines> getCompiledDefines() const;
+        [[nodiscard]] const std::vector<std::filesystem::path>& getSourceFiles() const;
+    private:
+        std::filesystem::path _cacheDirectory;
+        std::filesystem::path _sourcePath;
+        ShaderAssembler _assembler;
+        std::string _source;
+
+        struct Variant
+        {
+            ShaderDefines defines;
+            std::unique_ptr<sf::Shader> shader;
+        };
+
+        std::map<std::string, Variant> _variants;
+        std::set<std::string> _failed;
+
+        [[nodiscard]] std::string generateSource(const ShaderDefines &defines) const;
+        [[nodiscard]] std::filesystem::path getCachePath(const std::string &key) const;
+    };
+}
@@ -0,0 +1,107 @@
+#include "tilescheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+raymarch::TileScheduler::TileScheduler(const sf::Vector2u &resolution, const unsigned int tileSize) :
+    _tileSize(std::max(1u, tileSize))
+{
+    resize(resolution);
+}
+
+void raymarch::TileScheduler::resize(const sf::Vector2u &resolution)
+{
+    _resolution = resolution;
+    _tilesX = (resolution.x + _tileSize - 1) / _tileSize;
+    _tileCount = _tilesX * ((resolution.y + _tileSize - 1) / _tileSize);
+
+    // Cost per tile is unknown again, the first frame draws a whole pass
+    _averageTileCost = 0;
+    startPass();
+}
+
+void raymarch::TileScheduler::setBudget(const float milliseconds)
+{
+    _budget = std::max(0.0f, milliseconds);
+}
+
+void raymarch::TileScheduler::startPass()
+{
+    _nextTile = 0;
+}
+
+void raymarch::TileScheduler::advance(const unsigned int tiles)
+{
+    _nextTile = std::min(_tileCount, _nextTile + tiles);
+}
+
+void raymarch::TileScheduler::addCost(const unsigned int tiles, const float milliseconds)
+{
+    if (tiles == 0) return;
+
+    const float tileCost = milliseconds / static_cast<float>(tiles);
+    _averageTileCost = (_averageTileCost == 0) ? tileCost : _averageTileCost + (tileCost - _averageTileCost) * _smoothing;
+}
+
+bool raymarch::TileScheduler::isEnabled() const
+{
+    return _budget > 0;
+}
+
+bool raymarch::TileScheduler::isPassComplete() const
+{
+    return _nextTile >= _tileCount;
+}
+
+bool raymarch::TileScheduler::isPassStarted() const
+{
+    return _nextTile > 0;
+}
+
+unsigned int raymarch::TileScheduler::getNextTile() const
+{
+    return _nextTile;
+}
+
+unsigned int raymarch::TileScheduler::getTileBudget() const
+{
+    const unsigned int remaining = _tileCount - std::min(_nextTile, _tileCount);
+    if (!isEnabled() || _averageTileCost == 0) return remaining;
+
+    // At least one tile per frame, so a pass always finishes
+    const auto affordable = static_cast<unsigned int>(std::floor(_budget / _averageTileCost));
+    return std::clamp(affordable, 1u, std::max(1u, remaining));
+}
+
+sf::IntRect raymarch::TileScheduler::getTile(const unsigned int index) const
+{
+    const unsigned int x = (index % _tilesX) * _tileSize;
+    const unsigned int y = (index / _tilesX) * _tileSize;
+
+    const sf::Vector2i position {static_cast<int>(x), static_cast<int>(y)};
+    const sf::Vector2i size {
+        static_cast<int>(std::min(_tileSize, _resolution.x - x)),
+        static_cast<int>(std::min(_tileSize, _resolution.y - y))
+    };
+
+    return {position, size};
+}
+
+std::array<sf::IntRect, 2> raymarch::TileScheduler::getCompletedArea() const
+{
+    if (_tilesX == 0) return {};
+
+    // Tiles are handed out row by row: the finished rows, then the finished part of the current row
+    const unsigned int fullRows = _nextTile / _tilesX;
+    const unsigned int partialTiles = _nextTile % _tilesX;
+
+    const int rowsHeight = static_cast<int>(std::min(fullRows * _tileSize, _resolution.y));
+    const int partialY = rowsHeight;
+    const int partialHeight = static_cast<int>(std::min(_tileSize, _resolution.y - std::min(_resolution.y, static_cast<unsigned int>(partialY))));
+    const int partialWidth = static_cast<int>(std::min(partialTiles * _tileSize, _resolution.x));
+
+    return {
+        sf::IntRect {{0, 0}, {static_cast<int>(_resolution.x), rowsHeight}},
+        sf::IntRect {{0, partialY}, {partialWidth, partialTiles > 0 ? partialHeight : 0}}
+    };
+}
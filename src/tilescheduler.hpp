@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Splits a full-resolution pass into screen tiles and hands out as many per frame as fit the time budget
+    class TileScheduler
+    {
+    public:
+        TileScheduler(const sf::Vector2u &resolution, unsigned int tileSize);
+
+        void resize(const sf::Vector2u &resolution);
+        void setBudget(float milliseconds);
+        void startPass();
+        void advance(unsigned int tiles);
+
+        // GPU time of tiles drawn in an earlier frame, it sets the budget of the next ones
+        void addCost(unsigned int tiles, float milliseconds);
+
+        [[nodiscard]] bool isEnabled() const;
+        [[nodiscard]] bool isPassComplete() const;
+        [[nodiscard]] bool isPassStarted() const;
+        [[nodiscard]] unsigned int getNextTile() const;
+        [[nodiscard]] unsigned int getTileBudget() const;
+        [[nodiscard]] sf::IntRect getTile(unsigned int index) const;
+        [[nodiscard]] std::array<sf::IntRect, 2> getCompletedArea() const;
+    private:
+        sf::Vector2u _resolution;
+        unsigned int _tileSize;
+        unsigned int _tilesX = 0;
+        unsigned int _tileCount = 0;
+        unsigned int _nextTile = 0;
+
+        float _budget = 0;
+        float _averageTileCost = 0;
+
+        static constexpr float _smoothing = 0.25f;
+    };
+}
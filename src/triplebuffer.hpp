@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace raymarch
+{
+    // One writer and one reader share a value without locks: the writer never waits, the reader gets the newest complete copy
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        explicit TripleBuffer(const T &initial) :
+            _slots {initial, initial, initial}
+        {
+        }
+
+        // Writer: fills its private slot and swaps it with the shared one, marked as fresh
+        void publish(const T &value)
+        {
+            _slots[_back] = value;
+            _back = _middle.exchange(static_cast<std::uint8_t>(_back | freshBit), std::memory_order_acq_rel) & indexMask;
+        }
+
+        // Reader: takes the shared slot if it is fresh, otherwise keeps reading the last one
+        const T& read()
+        {
+            if (_middle.load(std::memory_order_relaxed) & freshBit)
+                _front = _middle.exchange(_front, std::memory_order_acq_rel) & indexMask;
+            return _slots[_front];
+        }
+    private:
+        static constexpr std::uint8_t indexMask = 3;
+        static constexpr std::uint8_t freshBit = 4;
+
+        std::array<T, 3> _slots;
+        std::uint8_t _back = 0;
+        std::atomic<std::uint8_t> _middle {1};
+        std::uint8_t _front = 2;
+    };
+}
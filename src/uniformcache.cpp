@@ -0,0 +1,177 @@
+#include "uniformcache.hpp"
+
+#include <algorithm>
+
+#include "glhelpers.hpp"
+
+raymarch::UniformCache::~UniformCache()
+{
+    if (_cameraBuffer != 0)
+        gl::deleteBuffer(_cameraBuffer);
+}
+
+void raymarch::UniformCache::attach(sf::Shader* shader, const bool cameraBlock)
+{
+    _shader = shader;
+    _uniforms.clear();
+    _dirty.clear();
+    _textures.clear();
+
+    // Without the raw entry points the cache still skips unchanged values, through sf::Shader
+    _rawUniforms = gl::loadUniformFunctions();
+
+    _cameraBlock = cameraBlock && _shader && gl::supportsUniformBuffers();
+    if (!_cameraBlock) return;
+
+    if (_cameraBuffer == 0)
+        _cameraBuffer = gl::createUniformBuffer(_cameraBlockSize);
+    gl::bindUniformBlock(_shader->getNativeHandle(), "Camera", _cameraBuffer, 0);
+    _cameraDirty = true;
+}
+
+void raymarch::UniformCache::set(const std::string &name, const float value)
+{
+    store(name, Type::Float, &value, 1);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const int value)
+{
+    store(name, Type::Int, nullptr, 0, value);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const bool value)
+{
+    store(name, Type::Int, nullptr, 0, value ? 1 : 0);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const sf::Vector2f &value)
+{
+    const float values[2] = {value.x, value.y};
+    store(name, Type::Vec2, values, 2);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const sf::Vector3f &value)
+{
+    const float values[3] = {value.x, value.y, value.z};
+    store(name, Type::Vec3, values, 3);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const sf::Glsl::Mat3 &value)
+{
+    store(name, Type::Mat3, value.array, 9);
+}
+
+void raymarch::UniformCache::set(const std::string &name, const sf::Texture &texture)
+{
+    // SFML keeps the texture unit assignment, it only needs to hear about a different texture
+    const sf::Texture*& current = _textures[name];
+    if (current == &texture || !_shader) return;
+
+    _shader->setUniform(name, texture);
+    current = &texture;
+}
+
+void raymarch::UniformCache::flush()
+{
+    if (!_shader) return;
+
+    if (!_dirty.empty())
+    {
+        // One program bind for every changed value instead of one per setUniform
+        if (_rawUniforms)
+            sf::Shader::bind(_shader);
+
+        for (const auto& [name, uniform] : _dirty)
+            upload(*name, *uniform);
+        _dirty.clear();
+
+        if (_rawUniforms)
+            sf::Shader::bind(nullptr);
+    }
+
+    if (_cameraBlock && _cameraDirty)
+    {
+        gl::updateUniformBuffer(_cameraBuffer, _cameraData.data(), _cameraBlockSize);
+        _cameraDirty = false;
+    }
+}
+
+void raymarch::UniformCache::store(const std::string &name, const Type type, const float* values, const std::size_t count, const int integer)
+{
+    if (_cameraBlock && storeInBlock(name, type, values, count)) return;
+
+    auto [entry, inserted] = _uniforms.try_emplace(name);
+    Uniform& uniform = entry->second;
+
+    const bool changed = inserted || uniform.type != type || uniform.integer != integer ||
+                         !std::equal(values, values + count, uniform.values.begin());
+    if (!changed) return;
+
+    uniform.type = type;
+    uniform.integer = integer;
+    std::copy_n(values, count, uniform.values.begin());
+
+    if (!uniform.dirty || inserted)
+        _dirty.emplace_back(&entry->first, &uniform);
+    uniform.dirty = true;
+}
+
+bool raymarch::UniformCache::storeInBlock(const std::string &name, const Type type, const float* values, const std::size_t count)
+{
+    const auto member = std::find_if(_cameraMembers.begin(), _cameraMembers.end(),
+                                     [&](const BlockMember &candidate) { return name == candidate.name; });
+    if (member == _cameraMembers.end() || member->type != type) return false;
+
+    float* data = _cameraData.data() + member->offset / sizeof(float);
+
+    // std140 pads every mat3 column to four floats
+    if (type == Type::Mat3)
+    {
+        for (std::size_t column = 0; column < 3; ++column)
+        {
+            if (std::equal(values + column * 3, values + column * 3 + 3, data + column * 4)) continue;
+            std::copy_n(values + column * 3, 3, data + column * 4);
+            _cameraDirty = true;
+        }
+        return true;
+    }
+
+    if (!std::equal(values, values + count, data))
+    {
+        std::copy_n(values, count, data);
+        _cameraDirty = true;
+    }
+    return true;
+}
+
+void raymarch::UniformCache::upload(const std::string &name, Uniform &uniform)
+{
+    uniform.dirty = false;
+
+    if (!_rawUniforms)
+    {
+        switch (uniform.type)
+        {
+            case Type::Float: _shader->setUniform(name, uniform.values[0]); break;
+            case Type::Int: _shader->setUniform(name, uniform.integer); break;
+            case Type::Vec2: _shader->setUniform(name, sf::Glsl::Vec2(uniform.values[0], uniform.values[1])); break;
+            case Type::Vec3: _shader->setUniform(name, sf::Glsl::Vec3(uniform.values[0], uniform.values[1], uniform.values[2])); break;
+            case Type::Mat3: _shader->setUniform(name, sf::Glsl::Mat3(uniform.values.data())); break;
+        }
+        return;
+    }
+
+    // Resolved once per program, uniforms the compiler removed stay at -1 and are skipped
+    if (uniform.location == _unresolved)
+        uniform.location = gl::getUniformLocation(_shader->getNativeHandle(), name.c_str());
+    if (uniform.location < 0) return;
+
+    switch (uniform.type)
+    {
+        case Type::Float: gl::uniform(uniform.location, uniform.values[0]); break;
+        case Type::Int: gl::uniform(uniform.location, uniform.integer); break;
+        case Type::Vec2: gl::uniform(uniform.location, uniform.values[0], uniform.values[1]); break;
+        case Type::Vec3: gl::uniform(uniform.location, uniform.values[0], uniform.values[1], uniform.values[2]); break;
+        case Type::Mat3: gl::uniformMatrix3(uniform.location, uniform.values.data()); break;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace raymarch
+{
+    // Last value of every uniform of a program, only values that changed reach the driver on flush()
+    class UniformCache
+    {
+    public:
+        UniformCache() = default;
+        ~UniformCache();
+
+        UniformCache(const UniformCache&) = delete;
+        UniformCache& operator=(const UniformCache&) = delete;
+
+        // Forgets everything uploaded so far, the camera uniforms move to a buffer if the program declares the block
+        void attach(sf::Shader* shader, bool cameraBlock);
+
+        void set(const std::string &name, float value);
+        void set(const std::string &name, int value);
+        void set(const std::string &name, bool value);
+        void set(const std::string &name, const sf::Vector2f &value);
+        void set(const std::string &name, const sf::Vector3f &value);
+        void set(const std::string &name, const sf::Glsl::Mat3 &value);
+        void set(const std::string &name, const sf::Texture &texture);
+
+        void flush();
+    private:
+        enum class Type
+        {
+            Float,
+            Int,
+            Vec2,
+            Vec3,
+            Mat3
+        };
+
+        struct Uniform
+        {
+            Type type = Type::Float;
+            std::array<float, 9> values {};
+            int integer = 0;
+            int location = _unresolved;
+            bool dirty = true;
+        };
+
+        // std140 layout of the Camera block in main.frag
+        struct BlockMember
+        {
+            const char* name;
+            Type type;
+            std::size_t offset;
+        };
+
+        static constexpr int _unresolved = -2;
+        static constexpr std::size_t _cameraBlockSize = 96;
+        static constexpr std::array<BlockMember, 9> _cameraMembers {{
+            {"camRotationMatrix", Type::Mat3, 0},
+            {"camPosition", Type::Vec3, 48},
+            {"fov", Type::Float, 60},
+            {"aperture", Type::Float, 64},
+            {"focusDistance", Type::Float, 68},
+            {"iTime", Type::Float, 72},
+            {"sampleIndex", Type::Float, 76},
+            {"referencePoint", Type::Vec3, 80},
+            {"detailScale", Type::Float, 92}
+        }};
+
+        sf::Shader* _shader = nullptr;
+        bool _rawUniforms = false;
+
+        std::unordered_map<std::string, Uniform> _uniforms;
+        std::vector<std::pair<const std::string*, Uniform*>> _dirty;
+        std::unordered_map<std::string, const sf::Texture*> _textures;
+
+        bool _cameraBlock = false;
+        bool _cameraDirty = false;
+        std::array<float, _cameraBlockSize / sizeof(float)> _cameraData {};
+        unsigned int _cameraBuffer = 0;
+
+        void store(const std::string &name, Type type, const float* values, std::size_t count, int integer = 0);
+        [[nodiscard]] bool storeInBlock(const std::string &name, Type type, const float* values, std::size_t count);
+        void upload(const std::string &name, Uniform &uniform);
+    };
+}